@@ -14,6 +14,44 @@ function msg_performance_ping($in, &$out)
 }
 // }}}
 
+// performance.batch {{{
+MSG("performance.batch", array(
+    "in"    => array("messages" => PARAM_STR),
+    "out"   => array("results", "duration"),
+    "check" => array("default_msg_check"),
+    "doc"   => "Mehrere Nachrichten in einem Request ausführen (JSON-Array aus {\"msg\": ..., \"in\": {...}})."
+));
+
+function msg_performance_batch($in, &$out)
+{
+    $messages = json_decode($in["messages"], TRUE);
+
+    if (!is_array($messages))
+        return -1;
+
+    $t_start = hrtime(TRUE);
+    $results = [];
+
+    foreach ($messages as $message) {
+        $fqmn = isset($message["msg"]) ? $message["msg"] : "";
+
+        if (!in_array($fqmn, performance_batch_messages())) {
+            $results[] = ["msg" => $fqmn, "status" => -2, "out" => []];
+            continue;
+        }
+
+        $msg_in = isset($message["in"]) && is_array($message["in"]) ? $message["in"] : [];
+        $msg_out = [];
+        $status = call_user_func_array("msg_" . str_replace(".", "_", $fqmn), [$msg_in, &$msg_out]);
+
+        $results[] = ["msg" => $fqmn, "status" => (int) $status, "out" => $msg_out];
+    }
+
+    $out["results"] = $results;
+    $out["duration"] = performance_elapsed_ms($t_start);
+}
+// }}}
+
 // performance.db_insert_single {{{
 MSG("performance.db_insert_single", array(
     "in"    => array("rows" => PARAM_INT),
@@ -103,6 +141,13 @@ function msg_performance_create_cos($in, &$out)
 
 // ---------------------------------------------------------------------------
 
+// Messages that may be sent in a performance.batch envelope. Only messages with the
+// same checks as performance.batch itself, since the batch does not run their checks.
+function performance_batch_messages()
+{
+    return ["performance.ping"];
+}
+
 function performance_drop_table($table_name)
 {
     global $core;
@@ -129,7 +174,7 @@ function performance_test_single_inserts($table_name, $num_insert_rows)
     global $core;
 
     sleep(1);
-    $t_start = microtime(TRUE);
+    $t_start = hrtime(TRUE);
 
     for ($i = 1; $i <= $num_insert_rows; ++$i) {
         $t = strftime("%Y-%m-%d %H:%M:%S", time());
@@ -140,7 +185,7 @@ function performance_test_single_inserts($table_name, $num_insert_rows)
             return FALSE;
     }
 
-    return (int) ((microtime(TRUE) - $t_start) * 1000.0);
+    return performance_elapsed_ms($t_start);
 }
 
 function performance_test_multiple_inserts($table_name, $num_insert_rows, $num_rows_per_multi_insert)
@@ -148,7 +193,7 @@ function performance_test_multiple_inserts($table_name, $num_insert_rows, $num_r
     global $core;
 
     sleep(1);
-    $t_start = microtime(TRUE);
+    $t_start = hrtime(TRUE);
 
     $insert_values = [];
 
@@ -173,7 +218,13 @@ function performance_test_multiple_inserts($table_name, $num_insert_rows, $num_r
             return FALSE;
     }
 
-    return (int) ((microtime(TRUE) - $t_start) * 1000.0);
+    return performance_elapsed_ms($t_start);
+}
+
+// Milliseconds since $t_start (from hrtime(TRUE)), with microsecond resolution.
+function performance_elapsed_ms($t_start)
+{
+    return round((hrtime(TRUE) - $t_start) / 1e6, 3);
 }
 
 function performance_delete_children($co_parent)
@@ -189,7 +240,7 @@ function performance_create_children($co_parent, $count)
     global $core;
 
     sleep(1);
-    $t_start = microtime(TRUE);
+    $t_start = hrtime(TRUE);
 
     $co_settings = settings_create($co_parent, "performance.create_cos", [
         "time" => strftime("%Y-%m-%d %H:%M:%S", time()),
@@ -206,7 +257,7 @@ function performance_create_children($co_parent, $count)
             return FALSE;
     }
 
-    return (int) ((microtime(TRUE) - $t_start) * 1000.0);
+    return performance_elapsed_ms($t_start);
 }
 
 // vim:et:ts=2:sw=2:foldmethod=marker:
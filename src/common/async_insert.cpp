@@ -0,0 +1,223 @@
+#include "async_insert.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+#include <spdlog/spdlog.h>
+
+#include "trace.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+
+struct AsyncConnection {
+    MYSQL* mysql;
+    std::string query;
+    TimingClock::time_point start;
+    TimingClock::time_point sent;  // mysql_real_query_start() returned
+    int wait_status = 0;
+    std::chrono::steady_clock::time_point timeout;
+};
+
+// Closes the epoll instance, also when the event loop throws.
+struct EpollInstance {
+    int fd;
+
+    EpollInstance() : fd{epoll_create1(0)} { }
+    ~EpollInstance()
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    EpollInstance(const EpollInstance&) = delete;
+    EpollInstance& operator=(const EpollInstance&) = delete;
+};
+
+static std::uint32_t epoll_events_from_wait_status(const int wait_status)
+{
+    std::uint32_t events = 0;
+
+    if (wait_status & MYSQL_WAIT_READ)
+        events |= EPOLLIN;
+    if (wait_status & MYSQL_WAIT_WRITE)
+        events |= EPOLLOUT;
+    if (wait_status & MYSQL_WAIT_EXCEPT)
+        events |= EPOLLPRI;
+
+    return events;
+}
+
+static int wait_status_from_epoll_events(const std::uint32_t events)
+{
+    int wait_status = 0;
+
+    if (events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+        wait_status |= MYSQL_WAIT_READ;
+    if (events & EPOLLOUT)
+        wait_status |= MYSQL_WAIT_WRITE;
+    if (events & EPOLLPRI)
+        wait_status |= MYSQL_WAIT_EXCEPT;
+
+    return wait_status;
+}
+
+// Drive all connections from one epoll loop. Every connection always has a statement in flight
+// until next_statement() runs out of work for it.
+AsyncInsertResults run_async_inserts(std::vector<MariaDBConnection>& connections, const NextStatementFunc& next_statement)
+{
+    AsyncInsertResults results{0, 0};
+    std::vector<AsyncConnection> conns;
+    int num_active = 0;
+
+    const EpollInstance epoll;
+    const int epfd = epoll.fd;
+
+    if (epfd < 0)
+        throw std::runtime_error{"unable to create epoll instance"};
+
+    for (int i = 0; i < std::ssize(connections); ++i) {
+        conns.push_back(AsyncConnection{connections[static_cast<std::size_t>(i)].get(), {}, {}, {}, 0, {}});
+
+        epoll_event ev{};
+        ev.events = 0;
+        ev.data.u32 = static_cast<std::uint32_t>(i);
+
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, mysql_get_socket(conns.back().mysql), &ev) < 0)
+            throw std::runtime_error{"unable to add connection to epoll instance"};
+    }
+
+    const auto wait_for = [&](const int i, const int wait_status) {
+        AsyncConnection& conn = conns[static_cast<std::size_t>(i)];
+        conn.wait_status = wait_status;
+
+        if (wait_status & MYSQL_WAIT_TIMEOUT)
+            conn.timeout = std::chrono::steady_clock::now() + std::chrono::milliseconds{mysql_get_timeout_value_ms(conn.mysql)};
+
+        epoll_event ev{};
+        ev.events = epoll_events_from_wait_status(wait_status);
+        ev.data.u32 = static_cast<std::uint32_t>(i);
+
+        // without epoll the statement can never finish, so give up on the connection
+        if (epoll_ctl(epfd, EPOLL_CTL_MOD, mysql_get_socket(conn.mysql), &ev) < 0) {
+            spdlog::get("combined")->error("unable to wait for connection {}, dropping it", i);
+            ++results.num_errors;
+            conn.wait_status = 0;
+            --num_active;
+        }
+    };
+
+    const auto finish_statement = [&](const int i, const int err) {
+        AsyncConnection& conn = conns[static_cast<std::size_t>(i)];
+
+        // statements of all connections overlap on this thread, so every connection gets its own track
+        const auto name = std::string_view{conn.query}.substr(0, conn.query.find(' '));
+        trace_async_event(name, "send", i, conn.start, conn.sent);
+        trace_async_event(name, "wait", i, conn.sent, TimingClock::now());
+
+        if (err) {
+            spdlog::get("combined")->error("{} ({})", mysql_error(conn.mysql), mysql_errno(conn.mysql));
+            ++results.num_errors;
+        } else {
+            ++results.num_statements;
+        }
+    };
+
+    // Send statements on a connection until one of them has to wait for the socket.
+    const auto start_next_statements = [&](const int i) {
+        AsyncConnection& conn = conns[static_cast<std::size_t>(i)];
+
+        while (true) {
+            auto query = next_statement(i);
+
+            if (!query.has_value()) {
+                conn.wait_status = 0;
+                --num_active;
+                return;
+            }
+
+            conn.query = std::move(*query);
+
+            int err = 0;
+            conn.start = TimingClock::now();
+            const int wait_status = mysql_real_query_start(&err, conn.mysql, conn.query.data(), conn.query.size());
+            conn.sent = TimingClock::now();
+
+            if (wait_status) {
+                wait_for(i, wait_status);
+                return;
+            }
+
+            finish_statement(i, err);
+        }
+    };
+
+    const auto continue_statement = [&](const int i, const int ready_status) {
+        AsyncConnection& conn = conns[static_cast<std::size_t>(i)];
+
+        int err = 0;
+        const int wait_status = mysql_real_query_cont(&err, conn.mysql, ready_status);
+
+        if (wait_status) {
+            wait_for(i, wait_status);
+        } else {
+            finish_statement(i, err);
+            start_next_statements(i);
+        }
+    };
+
+    num_active = static_cast<int>(conns.size());
+
+    for (int i = 0; i < std::ssize(conns); ++i)
+        start_next_statements(i);
+
+    std::vector<epoll_event> events(std::max<std::size_t>(conns.size(), 1));
+
+    while (num_active > 0) {
+        int timeout_ms = -1;
+        const auto now = std::chrono::steady_clock::now();
+
+        for (const auto& conn : conns) {
+            if (conn.wait_status & MYSQL_WAIT_TIMEOUT) {
+                const auto ms = std::max(0, static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(conn.timeout - now).count()));
+                timeout_ms = timeout_ms < 0 ? ms : std::min(timeout_ms, ms);
+            }
+        }
+
+        const int num_events = epoll_wait(epfd, events.data(), static_cast<int>(events.size()), timeout_ms);
+
+        for (int e = 0; e < num_events; ++e) {
+            const auto i = static_cast<int>(events[static_cast<std::size_t>(e)].data.u32);
+
+            if (conns[static_cast<std::size_t>(i)].wait_status)
+                continue_statement(i, wait_status_from_epoll_events(events[static_cast<std::size_t>(e)].events));
+        }
+
+        const auto after_wait = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < std::ssize(conns); ++i) {
+            const auto& conn = conns[static_cast<std::size_t>(i)];
+
+            if ((conn.wait_status & MYSQL_WAIT_TIMEOUT) && conn.timeout <= after_wait)
+                continue_statement(i, MYSQL_WAIT_TIMEOUT);
+        }
+    }
+
+    return results;
+}
+
+#else
+
+AsyncInsertResults run_async_inserts(std::vector<MariaDBConnection>&, const NextStatementFunc&)
+{
+    throw std::runtime_error{"async insert engine requires epoll (Linux only)"};
+}
+
+#endif
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "mariadb.h"
+
+struct AsyncInsertResults {
+    std::int64_t num_statements;
+    std::int64_t num_errors;
+};
+
+// Returns the next statement for the connection with the given index or nothing when there is no more work.
+using NextStatementFunc = std::function<std::optional<std::string>(int)>;
+
+AsyncInsertResults run_async_inserts(std::vector<MariaDBConnection>& connections, const NextStatementFunc& next_statement);
@@ -0,0 +1,134 @@
+#include "capture.h"
+
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+
+#include <fmt/core.h>
+
+// Capture file format: the magic string followed by records of
+//
+//   int64 send_time_us, float latency_ms, int32 status,
+//   uint16 fqmn length, fqmn, uint16 number of data pairs,
+//   for every pair: uint16 key length, key, uint32 value length, value
+//
+// in native byte order.
+constexpr std::string_view capture_magic{"MSGCAP1\n"};
+
+static std::mutex capture_mutex;
+static std::ofstream capture_file;
+static TimingClock::time_point capture_start;
+
+template <typename T>
+static void write_value(std::ofstream& out, const T value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename Length>
+static void write_string(std::ofstream& out, const std::string& s)
+{
+    write_value(out, static_cast<Length>(s.size()));
+    out.write(s.data(), static_cast<std::streamsize>(s.size()));
+}
+
+template <typename T>
+static T read_value(std::ifstream& in)
+{
+    T value{};
+    in.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return value;
+}
+
+// Reads a length-prefixed string. The length is checked against the bytes left in the file, so a corrupt
+// length field fails the read instead of allocating up to 4GB.
+template <typename Length>
+static std::string read_string(std::ifstream& in, const std::streamoff file_size)
+{
+    const auto length = read_value<Length>(in);
+
+    if (!in || static_cast<std::streamoff>(length) > file_size - in.tellg()) {
+        in.setstate(std::ios::failbit);
+        return {};
+    }
+
+    std::string s(length, '\0');
+    in.read(s.data(), static_cast<std::streamsize>(s.size()));
+    return s;
+}
+
+void start_capture(const std::string& filename)
+{
+    std::lock_guard<std::mutex> lock{capture_mutex};
+
+    capture_file.open(filename, std::ios::binary | std::ios::trunc);
+
+    if (!capture_file.is_open())
+        throw std::runtime_error{fmt::format("unable to open capture file: {}", filename)};
+
+    capture_file.write(capture_magic.data(), static_cast<std::streamsize>(capture_magic.size()));
+    capture_start = TimingClock::now();
+}
+
+bool capture_enabled()
+{
+    std::lock_guard<std::mutex> lock{capture_mutex};
+    return capture_file.is_open();
+}
+
+void capture_record(const TimingClock::time_point send_time, const float latency_ms, const int status, const std::string& fqmn, const std::vector<std::pair<std::string, std::string>>& data)
+{
+    std::lock_guard<std::mutex> lock{capture_mutex};
+
+    if (!capture_file.is_open())
+        return;
+
+    write_value(capture_file, static_cast<std::int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(send_time - capture_start).count()));
+    write_value(capture_file, latency_ms);
+    write_value(capture_file, static_cast<std::int32_t>(status));
+    write_string<std::uint16_t>(capture_file, fqmn);
+    write_value(capture_file, static_cast<std::uint16_t>(data.size()));
+
+    for (const auto& [key, value] : data) {
+        write_string<std::uint16_t>(capture_file, key);
+        write_string<std::uint32_t>(capture_file, value);
+    }
+}
+
+std::vector<CaptureRecord> read_capture(const std::string& filename)
+{
+    std::ifstream in{filename, std::ios::binary | std::ios::ate};
+    const std::streamoff file_size = in.tellg();
+    in.seekg(0);
+
+    std::string magic(capture_magic.size(), '\0');
+
+    if (!in.read(magic.data(), static_cast<std::streamsize>(magic.size())) || magic != capture_magic)
+        throw std::runtime_error{fmt::format("not a capture file: {}", filename)};
+
+    std::vector<CaptureRecord> records;
+
+    while (in.peek() != std::ifstream::traits_type::eof()) {
+        CaptureRecord record;
+        record.send_time_us = read_value<std::int64_t>(in);
+        record.latency_ms = read_value<float>(in);
+        record.status = read_value<std::int32_t>(in);
+        record.fqmn = read_string<std::uint16_t>(in, file_size);
+
+        const auto num_pairs = read_value<std::uint16_t>(in);
+
+        for (std::uint16_t i = 0; i < num_pairs && in; ++i) {
+            auto key = read_string<std::uint16_t>(in, file_size);
+            auto value = read_string<std::uint32_t>(in, file_size);
+            record.data.emplace_back(std::move(key), std::move(value));
+        }
+
+        if (!in)
+            throw std::runtime_error{fmt::format("truncated capture file: {}", filename)};
+
+        records.push_back(std::move(record));
+    }
+
+    return records;
+}
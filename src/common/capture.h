@@ -0,0 +1,22 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "timing.h"
+
+struct CaptureRecord {
+    std::int64_t send_time_us;  // since the capture was started
+    float latency_ms;
+    int status;                 // message status, -1 for failed requests
+    std::string fqmn;
+    std::vector<std::pair<std::string, std::string>> data;
+};
+
+void start_capture(const std::string& filename);
+bool capture_enabled();
+void capture_record(TimingClock::time_point send_time, float latency_ms, int status, const std::string& fqmn, const std::vector<std::pair<std::string, std::string>>& data);
+std::vector<CaptureRecord> read_capture(const std::string& filename);
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fmt/core.h>
+#include <spdlog/spdlog.h>
+#include <sqlpp11/mysql/mysql.h>
+#include <sqlpp11/sqlpp11.h>
+
+#include "timing.h"
+#include "trace.h"
+
+// Generic multi-row insert benchmark for any table type generated by sqlpp11-ddl2cpp.
+// Rows are generated at compile time from the value types of all insertable columns.
+// Numbers are the row number, wrapped around at the largest value the column holds, and strings
+// and BLOBs are cut to the declared column length, so the generated values fit every column
+// under strict SQL mode and stay unique for unique keys.
+
+struct RowGeneratorConfig {
+    std::size_t varchar_length = 32;
+    std::size_t blob_length = 256;
+};
+
+template <typename Column>
+inline constexpr bool is_insertable_column = !sqlpp::must_not_insert_t<Column>::value;
+
+template <typename Column>
+auto insertable_column(const Column& column)
+{
+    if constexpr (is_insertable_column<Column>)
+        return std::tuple<Column>{column};
+    else
+        return std::tuple<>{};
+}
+
+template <typename Table>
+auto insertable_columns()
+{
+    return std::apply([](const auto&... columns) { return std::tuple_cat(insertable_column(columns)...); }, typename Table::_column_tuple_t{});
+}
+
+// Limits of a column as declared in the database.
+struct ColumnLimits {
+    std::size_t max_length;   // characters of a varchar or bytes of a BLOB column
+    std::int64_t max_value;   // largest value of an integer or decimal column
+};
+
+namespace generic_insert_alias {
+SQLPP_ALIAS_PROVIDER(column_name)
+SQLPP_ALIAS_PROVIDER(data_type)
+SQLPP_ALIAS_PROVIDER(is_unsigned)
+SQLPP_ALIAS_PROVIDER(max_length)
+SQLPP_ALIAS_PROVIDER(integer_digits)
+}
+
+// Name of a table or column like sqlpp11 writes it into statements, in lower case and without table and quotes.
+template <typename Expression>
+std::string sql_name(sqlpp::mysql::connection& db, const Expression& expression)
+{
+    sqlpp::mysql::serializer_t context{db};
+    sqlpp::serialize(expression, context);
+
+    std::string name = context.str().substr(context.str().rfind('.') + 1);
+    std::erase(name, '`');
+    std::transform(name.begin(), name.end(), name.begin(), [](const unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    return name;
+}
+
+inline std::int64_t max_column_value(const std::string& data_type, const bool is_unsigned, const std::int64_t integer_digits)
+{
+    if (data_type == "tinyint")
+        return is_unsigned ? 255 : 127;
+    if (data_type == "smallint")
+        return is_unsigned ? 65535 : 32767;
+    if (data_type == "mediumint")
+        return is_unsigned ? 16777215 : 8388607;
+    if (data_type == "int")
+        return is_unsigned ? 4294967295 : 2147483647;
+
+    if (data_type == "decimal" && integer_digits < 19) {
+        std::int64_t max_value = 1;
+
+        for (std::int64_t i = 0; i < integer_digits; ++i)
+            max_value *= 10;
+
+        return max_value - 1;
+    }
+
+    return std::numeric_limits<std::int64_t>::max();
+}
+
+// Declared limits of all columns of the table, by column name in lower case.
+inline std::map<std::string, ColumnLimits> column_limits(sqlpp::mysql::connection& db, const std::string& table_name)
+{
+    namespace alias = generic_insert_alias;
+
+    const auto query = fmt::format(
+        "SELECT LOWER(column_name), data_type, column_type LIKE '%unsigned%', COALESCE(character_maximum_length, -1), "
+        "COALESCE(numeric_precision - numeric_scale, -1) FROM information_schema.columns WHERE table_schema = DATABASE() AND table_name = '{}'",
+        table_name);
+
+    const auto result_type = sqlpp::select(sqlpp::value(std::string{}).as(alias::column_name), sqlpp::value(std::string{}).as(alias::data_type),
+        sqlpp::value(std::int64_t{0}).as(alias::is_unsigned), sqlpp::value(std::int64_t{0}).as(alias::max_length), sqlpp::value(std::int64_t{0}).as(alias::integer_digits));
+
+    std::map<std::string, ColumnLimits> limits;
+
+    for (const auto& row : db(sqlpp::custom_query(sqlpp::verbatim(query)).with_result_type_of(result_type))) {
+        const std::int64_t max_length = row.max_length.value();
+
+        limits[row.column_name.value()] = ColumnLimits{
+            max_length < 0 ? std::numeric_limits<std::size_t>::max() : static_cast<std::size_t>(max_length),
+            max_column_value(row.data_type.value(), row.is_unsigned.value() != 0, row.integer_digits.value())};
+    }
+
+    return limits;
+}
+
+// How the values of one column are generated.
+struct GeneratedColumn {
+    std::size_t length;       // of varchar and BLOB values: the configured length, but not more than the column allows
+    std::int64_t max_value;
+};
+
+template <typename Column>
+GeneratedColumn generated_column(sqlpp::mysql::connection& db, const Column& column, const RowGeneratorConfig& config, const std::map<std::string, ColumnLimits>& limits)
+{
+    using ValueType = sqlpp::value_type_of<Column>;
+    GeneratedColumn generated{0, std::numeric_limits<std::int64_t>::max()};
+
+    if constexpr (std::is_same_v<ValueType, sqlpp::text>)
+        generated.length = config.varchar_length;
+    else if constexpr (std::is_same_v<ValueType, sqlpp::blob>)
+        generated.length = config.blob_length;
+
+    if (const auto it = limits.find(sql_name(db, column)); it != limits.end()) {
+        generated.length = std::min(generated.length, it->second.max_length);
+        generated.max_value = it->second.max_value;
+    }
+
+    return generated;
+}
+
+// Generate the value of one column for the given row.
+template <typename ValueType>
+auto generate_value(const GeneratedColumn& column, const std::int64_t row)
+{
+    // unique as long as the column can hold that many values
+    const std::int64_t number = row <= column.max_value ? row : row % (column.max_value + 1);
+
+    if constexpr (std::is_same_v<ValueType, sqlpp::integral>) {
+        return number;
+    } else if constexpr (std::is_same_v<ValueType, sqlpp::unsigned_integral>) {
+        return static_cast<std::uint64_t>(number);
+    } else if constexpr (std::is_same_v<ValueType, sqlpp::floating_point>) {
+        return static_cast<double>(number);
+    } else if constexpr (std::is_same_v<ValueType, sqlpp::boolean>) {
+        return row % 2 == 0;
+    } else if constexpr (std::is_same_v<ValueType, sqlpp::text>) {
+        std::string s = fmt::format("row {} ", row);
+        s.resize(column.length, 'x');
+        return s;
+    } else if constexpr (std::is_same_v<ValueType, sqlpp::blob>) {
+        std::vector<std::uint8_t> data(column.length);
+
+        for (std::size_t i = 0; i < data.size(); ++i)
+            data[i] = static_cast<std::uint8_t>(static_cast<std::uint64_t>(row) + i);
+
+        return data;
+    } else if constexpr (std::is_same_v<ValueType, sqlpp::day_point>) {
+        return std::chrono::time_point_cast<sqlpp::chrono::days>(std::chrono::system_clock::now());
+    } else if constexpr (std::is_same_v<ValueType, sqlpp::time_point>) {
+        return std::chrono::system_clock::now();
+    } else {
+        static_assert(!std::is_same_v<ValueType, ValueType>, "no row generator for this column type");
+    }
+}
+
+// Approximate number of bytes of one column value, used to report the row width.
+template <typename ValueType>
+std::size_t value_width(const std::size_t length)
+{
+    if constexpr (std::is_same_v<ValueType, sqlpp::text> || std::is_same_v<ValueType, sqlpp::blob>)
+        return length;
+    else if constexpr (std::is_same_v<ValueType, sqlpp::boolean>)
+        return 1;
+    else if constexpr (std::is_same_v<ValueType, sqlpp::day_point>)
+        return 3;
+    else
+        return 8;
+}
+
+template <typename Table>
+std::chrono::nanoseconds test_generic_inserts(sqlpp::mysql::connection& db, const std::int64_t num_insert_rows, const int num_rows_per_multi_insert, const RowGeneratorConfig& generator_config)
+{
+    Table table{};
+    const std::string table_name = sql_name(db, table);
+
+    spdlog::info("run test: insert multiple generated rows in one request into \"{}\"", table_name);
+
+    const auto columns = insertable_columns<Table>();
+    constexpr auto num_columns = std::tuple_size_v<std::decay_t<decltype(columns)>>;
+    auto multi_insert = std::apply([&](const auto&... cols) { return sqlpp::insert_into(table).columns(cols...); }, columns);
+
+    const auto limits = column_limits(db, table_name);
+    const auto generated_columns = std::apply([&](const auto&... cols) {
+        return std::array<GeneratedColumn, num_columns>{generated_column(db, cols, generator_config, limits)...};
+    }, columns);
+
+    const std::size_t row_width = [&]<std::size_t... I>(std::index_sequence<I...>) {
+        return (std::size_t{0} + ... + value_width<sqlpp::value_type_of<std::tuple_element_t<I, std::decay_t<decltype(columns)>>>>(generated_columns[I].length));
+    }(std::make_index_sequence<num_columns>{});
+
+    auto t0 = TimingClock::now();
+    auto batch_start = t0;
+
+    const auto send_multi_insert = [&] {
+        trace_event(table_name, "generate", batch_start, TimingClock::now());
+        {
+            TraceSpan span{"INSERT (sqlpp11)", "send"};
+            db(multi_insert);
+        }
+        multi_insert.values._data._insert_values.clear();
+        batch_start = TimingClock::now();
+    };
+
+    for (std::int64_t i = 0; i < num_insert_rows; ++i) {
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            multi_insert.values.add((std::get<I>(columns) = generate_value<sqlpp::value_type_of<std::tuple_element_t<I, std::decay_t<decltype(columns)>>>>(generated_columns[I], i))...);
+        }(std::make_index_sequence<num_columns>{});
+
+        if (std::ssize(multi_insert.values._data._insert_values) == num_rows_per_multi_insert)
+            send_multi_insert();
+    }
+
+    if (!multi_insert.values._data._insert_values.empty())
+        send_multi_insert();
+
+    auto t1 = TimingClock::now();
+
+    const auto ns = elapsed_ns(t0, t1);
+    const auto seconds = std::chrono::duration<double>(t1 - t0).count();
+
+    spdlog::get("combined")->info("test generic \"{}\": {} rows in {:.3f}ms (rows per insert: {}, columns: {}, row width: ~{} bytes, {:.0f} rows/s, {:.2f}MB/s)",
+        table_name, num_insert_rows, to_ms(ns), num_rows_per_multi_insert, num_columns, row_width,
+        static_cast<double>(num_insert_rows) / seconds, static_cast<double>(num_insert_rows) * static_cast<double>(row_width) / seconds / (1024.0 * 1024.0));
+
+    return ns;
+}
@@ -0,0 +1,225 @@
+#include "http_server.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <memory>
+#include <semaphore>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+#include <fmt/core.h>
+#include <spdlog/spdlog.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// Connections handled at the same time. Further clients wait in the listen backlog until a connection closes.
+constexpr std::ptrdiff_t max_connections = 256;
+
+using ConnectionSlots = std::counting_semaphore<max_connections>;
+
+static std::string_view status_text(const int status)
+{
+    switch (status) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        default: return "Internal Server Error";
+    }
+}
+
+static bool send_all(const int fd, const std::string_view& data)
+{
+    std::size_t sent = 0;
+
+    while (sent < data.size()) {
+        const auto n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+
+        if (n <= 0)
+            return false;
+
+        sent += static_cast<std::size_t>(n);
+    }
+
+    return true;
+}
+
+// Parse one request from the start of the buffer. Returns the number of consumed bytes or 0 if the request is incomplete.
+static std::size_t parse_request(const std::string& buffer, HttpRequest& request)
+{
+    const auto header_end = buffer.find("\r\n\r\n");
+
+    if (header_end == std::string::npos)
+        return 0;
+
+    request = HttpRequest{};
+
+    const auto request_line_end = buffer.find("\r\n");
+    const std::string_view request_line{buffer.data(), request_line_end};
+    const auto method_end = request_line.find(' ');
+    const auto target_end = request_line.find(' ', method_end + 1);
+
+    if (method_end == std::string_view::npos || target_end == std::string_view::npos)
+        throw std::runtime_error{"invalid request line"};
+
+    request.method = request_line.substr(0, method_end);
+    request.target = request_line.substr(method_end + 1, target_end - method_end - 1);
+
+    std::size_t pos = request_line_end + 2;
+
+    while (pos < header_end) {
+        const auto line_end = buffer.find("\r\n", pos);
+        const std::string_view line{buffer.data() + pos, line_end - pos};
+        const auto colon = line.find(':');
+
+        if (colon != std::string_view::npos) {
+            std::string name{line.substr(0, colon)};
+            std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+            auto value = line.substr(colon + 1);
+            value.remove_prefix(std::min(value.find_first_not_of(' '), value.size()));
+            request.headers[name] = value;
+        }
+
+        pos = line_end + 2;
+    }
+
+    std::size_t content_length = 0;
+
+    if (const auto it = request.headers.find("content-length"); it != request.headers.end())
+        content_length = std::stoul(it->second);
+
+    const std::size_t body_start = header_end + 4;
+
+    if (buffer.size() < body_start + content_length)
+        return 0;
+
+    request.body = buffer.substr(body_start, content_length);
+
+    return body_start + content_length;
+}
+
+// Handle all (keep-alive) requests of one client connection.
+static void handle_connection(const int fd, const HttpHandler& handler)
+{
+    std::string buffer;
+    char chunk[16 * 1024];
+
+    while (true) {
+        HttpRequest request;
+        std::size_t consumed = 0;
+
+        try {
+            consumed = parse_request(buffer, request);
+        } catch (const std::exception&) {
+            send_all(fd, "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            break;
+        }
+
+        if (consumed == 0) {
+            const auto n = recv(fd, chunk, sizeof(chunk), 0);
+
+            if (n <= 0)
+                break;
+
+            buffer.append(chunk, static_cast<std::size_t>(n));
+            continue;
+        }
+
+        buffer.erase(0, consumed);
+
+        HttpResponse response;
+
+        try {
+            response = handler(request);
+        } catch (const std::exception& e) {
+            spdlog::error("error handling request {}: {}", request.target, e.what());
+            response = HttpResponse{500, "text/plain", "internal server error\n"};
+        }
+
+        const auto connection = request.headers.find("connection");
+        const bool close_connection = connection != request.headers.end() && connection->second == "close";
+
+        const auto header = fmt::format("HTTP/1.1 {} {}\r\nContent-Type: {}\r\nContent-Length: {}\r\nConnection: {}\r\n\r\n",
+            response.status, status_text(response.status), response.content_type, response.body.size(), close_connection ? "close" : "keep-alive");
+
+        if (!send_all(fd, header) || !send_all(fd, response.body) || close_connection)
+            break;
+    }
+
+    close(fd);
+}
+
+// Minimal HTTP/1.1 server for local tooling: listens on the given address and port in a background thread
+// and handles every client connection in its own thread, up to max_connections at a time. Runs until the
+// program exits.
+void start_http_server(const std::string& address, const int port, HttpHandler handler)
+{
+    const int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (listen_fd < 0)
+        throw std::runtime_error{"unable to create socket"};
+
+    const int reuse = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<std::uint16_t>(port));
+
+    if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1)
+        throw std::runtime_error{fmt::format("invalid listen address: {}", address)};
+
+    if (bind(listen_fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listen_fd, SOMAXCONN) < 0)
+        throw std::runtime_error{fmt::format("unable to listen on {}:{}", address, port)};
+
+    spdlog::info("listening on http://{}:{}", address, port);
+
+    std::thread([listen_fd, handler = std::move(handler)] {
+        // shared with the connection threads, which can outlive this one at exit
+        const auto shared_handler = std::make_shared<const HttpHandler>(handler);
+        const auto slots = std::make_shared<ConnectionSlots>(max_connections);
+
+        while (true) {
+            slots->acquire();
+
+            const int fd = accept(listen_fd, nullptr, nullptr);
+
+            if (fd < 0) {
+                slots->release();
+                continue;
+            }
+
+            const int no_delay = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+            std::thread([fd, shared_handler, slots] {
+                handle_connection(fd, *shared_handler);
+                slots->release();
+            }).detach();
+        }
+    }).detach();
+}
+
+#else
+
+void start_http_server(const std::string&, int, HttpHandler)
+{
+    throw std::runtime_error{"http server requires POSIX sockets"};
+}
+
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+
+struct HttpRequest {
+    std::string method;
+    std::string target;
+    std::map<std::string, std::string> headers;  // lowercase header names
+    std::string body;
+};
+
+struct HttpResponse {
+    int status = 200;
+    std::string content_type = "text/plain";
+    std::string body;
+};
+
+using HttpHandler = std::function<HttpResponse(const HttpRequest&)>;
+
+void start_http_server(const std::string& address, int port, HttpHandler handler);
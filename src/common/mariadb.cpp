@@ -0,0 +1,115 @@
+#include "mariadb.h"
+
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+#include "trace.h"
+
+static const char* optional_c_str(const std::string& s)
+{
+    return s.empty() ? nullptr : s.c_str();
+}
+
+// Open a raw libmariadb connection with the same settings as sqlpp::mysql::connection.
+// Additional client flags (like CLIENT_MULTI_STATEMENTS) are added to the ones from the config.
+MariaDBConnection mariadb_connect(const sqlpp::mysql::connection_config& config, unsigned long client_flag, bool non_blocking)
+{
+    MariaDBConnection mysql{mysql_init(nullptr), &mysql_close};
+
+    if (!mysql)
+        throw std::runtime_error{"MariaDB unable to initialize connection"};
+
+    if (non_blocking)
+        mysql_options(mysql.get(), MYSQL_OPT_NONBLOCK, nullptr);
+
+    if (!mysql_real_connect(mysql.get(), optional_c_str(config.host), optional_c_str(config.user), optional_c_str(config.password),
+            optional_c_str(config.database), config.port, optional_c_str(config.unix_socket), config.client_flag | client_flag))
+        throw std::runtime_error{fmt::format("MariaDB unable to connect: {}", mysql_error(mysql.get()))};
+
+    if (mysql_set_character_set(mysql.get(), config.charset.c_str()))
+        throw std::runtime_error{fmt::format("MariaDB unable to set character set: {}", mysql_error(mysql.get()))};
+
+    return mysql;
+}
+
+// Same as mysql_real_query(), but sending the query and waiting for its result are traced separately.
+// The trace events are named after the first word of the query, like "INSERT".
+void mariadb_query(MYSQL* mysql, const std::string_view& query)
+{
+    const auto name = query.substr(0, query.find(' '));
+
+    {
+        TraceSpan span{name, "send"};
+
+        if (mysql_send_query(mysql, query.data(), query.size()))
+            throw std::runtime_error{fmt::format("MariaDB query failed: {}", mysql_error(mysql))};
+    }
+
+    TraceSpan span{name, "wait"};
+
+    if (mysql_read_query_result(mysql))
+        throw std::runtime_error{fmt::format("MariaDB query failed: {}", mysql_error(mysql))};
+}
+
+// Send multiple statements in one request and drain every result set.
+// The connection needs the CLIENT_MULTI_STATEMENTS flag.
+void mariadb_multi_query(MYSQL* mysql, const std::string_view& query)
+{
+    mariadb_query(mysql, query);
+
+    TraceSpan span{"results", "parse"};
+
+    while (true) {
+        if (MYSQL_RES* result = mysql_store_result(mysql))
+            mysql_free_result(result);
+
+        const int status = mysql_next_result(mysql);
+
+        if (status > 0)
+            throw std::runtime_error{fmt::format("MariaDB multi-statement query failed: {}", mysql_error(mysql))};
+
+        if (status < 0)
+            break;
+    }
+}
+
+// Return a column (default the first) of the first row of the result or an empty string for no rows and NULL.
+std::string mariadb_query_value(MYSQL* mysql, const std::string_view& query, const unsigned int column)
+{
+    mariadb_query(mysql, query);
+
+    MYSQL_RES* result = mysql_store_result(mysql);
+
+    if (!result)
+        throw std::runtime_error{fmt::format("MariaDB query returned no result: {}", mysql_error(mysql))};
+
+    std::string value;
+
+    if (MYSQL_ROW row = mysql_fetch_row(result); row && column < mysql_num_fields(result) && row[column])
+        value = row[column];
+
+    mysql_free_result(result);
+
+    return value;
+}
+
+// Return the first column of all rows of the result, NULL values as empty strings.
+std::vector<std::string> mariadb_query_column(MYSQL* mysql, const std::string_view& query)
+{
+    mariadb_query(mysql, query);
+
+    MYSQL_RES* result = mysql_store_result(mysql);
+
+    if (!result)
+        throw std::runtime_error{fmt::format("MariaDB query returned no result: {}", mysql_error(mysql))};
+
+    std::vector<std::string> values;
+
+    while (MYSQL_ROW row = mysql_fetch_row(result))
+        values.emplace_back(row[0] ? row[0] : "");
+
+    mysql_free_result(result);
+
+    return values;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <mysql.h>
+#include <sqlpp11/mysql/connection_config.h>
+
+using MariaDBConnection = std::unique_ptr<MYSQL, decltype(&mysql_close)>;
+
+MariaDBConnection mariadb_connect(const sqlpp::mysql::connection_config& config, unsigned long client_flag = 0, bool non_blocking = false);
+void mariadb_query(MYSQL* mysql, const std::string_view& query);
+void mariadb_multi_query(MYSQL* mysql, const std::string_view& query);
+std::string mariadb_query_value(MYSQL* mysql, const std::string_view& query, unsigned int column = 0);
+std::vector<std::string> mariadb_query_column(MYSQL* mysql, const std::string_view& query);
@@ -0,0 +1,65 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include "http_server.h"
+
+void record_success(Metrics& metrics, const float ms)
+{
+    const auto us = static_cast<std::uint64_t>(std::max(0.0f, ms) * 1000.0f);
+    const auto bucket = std::lower_bound(metrics_bucket_bounds.begin(), metrics_bucket_bounds.end(), ms) - metrics_bucket_bounds.begin();
+
+    metrics.buckets[static_cast<std::size_t>(bucket)].fetch_add(1, std::memory_order_relaxed);
+    metrics.duration_sum_us.fetch_add(us, std::memory_order_relaxed);
+    metrics.last_duration_us.store(us, std::memory_order_relaxed);
+    metrics.num_requests.fetch_add(1, std::memory_order_relaxed);
+}
+
+void record_error(Metrics& metrics)
+{
+    metrics.num_errors.fetch_add(1, std::memory_order_relaxed);
+    metrics.num_requests.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Render the metrics in Prometheus text exposition format, durations in seconds.
+std::string format_prometheus_metrics(const Metrics& metrics, const std::string_view& prefix)
+{
+    fmt::memory_buffer out;
+    auto it = std::back_inserter(out);
+
+    fmt::format_to(it, "# TYPE {0}_requests_total counter\n{0}_requests_total {1}\n", prefix, metrics.num_requests.load(std::memory_order_relaxed));
+    fmt::format_to(it, "# TYPE {0}_errors_total counter\n{0}_errors_total {1}\n", prefix, metrics.num_errors.load(std::memory_order_relaxed));
+    fmt::format_to(it, "# TYPE {0}_last_duration_seconds gauge\n{0}_last_duration_seconds {1:.6f}\n", prefix, static_cast<double>(metrics.last_duration_us.load(std::memory_order_relaxed)) / 1e6);
+    fmt::format_to(it, "# TYPE {}_duration_seconds histogram\n", prefix);
+
+    std::uint64_t count = 0;
+
+    for (std::size_t i = 0; i < metrics.buckets.size(); ++i) {
+        count += metrics.buckets[i].load(std::memory_order_relaxed);
+
+        if (i < metrics_bucket_bounds.size())
+            fmt::format_to(it, "{}_duration_seconds_bucket{{le=\"{}\"}} {}\n", prefix, metrics_bucket_bounds[i] / 1000.0f, count);
+        else
+            fmt::format_to(it, "{}_duration_seconds_bucket{{le=\"+Inf\"}} {}\n", prefix, count);
+    }
+
+    fmt::format_to(it, "{}_duration_seconds_sum {:.6f}\n", prefix, static_cast<double>(metrics.duration_sum_us.load(std::memory_order_relaxed)) / 1e6);
+    fmt::format_to(it, "{}_duration_seconds_count {}\n", prefix, count);
+
+    return fmt::to_string(out);
+}
+
+// Serve the metrics on http://127.0.0.1:<port>/metrics.
+void start_metrics_server(const int port, const Metrics& metrics, const std::string& prefix)
+{
+    start_http_server("127.0.0.1", port, [&metrics, prefix](const HttpRequest& request) {
+        if (request.target != "/metrics")
+            return HttpResponse{404, "text/plain", "not found\n"};
+
+        return HttpResponse{200, "text/plain; version=0.0.4", format_prometheus_metrics(metrics, prefix)};
+    });
+}
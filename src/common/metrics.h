@@ -0,0 +1,25 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Latency histogram bucket upper bounds in milliseconds, the last bucket is +Inf.
+inline constexpr std::array<float, 14> metrics_bucket_bounds{1, 2.5f, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000};
+
+// Live counters and latency histogram of a probe. Updated lock-free by the measuring loop
+// and read by the metrics endpoint.
+struct Metrics {
+    std::atomic<std::uint64_t> num_requests{0};
+    std::atomic<std::uint64_t> num_errors{0};
+    std::atomic<std::uint64_t> duration_sum_us{0};
+    std::atomic<std::uint64_t> last_duration_us{0};
+    std::array<std::atomic<std::uint64_t>, metrics_bucket_bounds.size() + 1> buckets{};
+};
+
+void record_success(Metrics& metrics, float ms);
+void record_error(Metrics& metrics);
+std::string format_prometheus_metrics(const Metrics& metrics, const std::string_view& prefix);
+void start_metrics_server(int port, const Metrics& metrics, const std::string& prefix);
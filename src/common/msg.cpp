@@ -1,24 +1,73 @@
 #include "msg.h"
 
+#include <curl/curl.h>
 #include <spdlog/spdlog.h>
 
+#include "capture.h"
+#include "trace.h"
+
+// Record the message if capturing is enabled. Login messages are never recorded, they contain the password.
+static void capture_msg(const TimingClock::time_point send_time, const float elapsed, const int status, const std::string& fqmn, const std::vector<cpr::Pair>& data)
+{
+    if (!capture_enabled() || fqmn.starts_with("login."))
+        return;
+
+    std::vector<std::pair<std::string, std::string>> pairs;
+
+    for (const auto& pair : data) {
+        if (pair.key != "msg")
+            pairs.emplace_back(pair.key, pair.value);
+    }
+
+    capture_record(send_time, elapsed, status, fqmn, pairs);
+}
+
+// Trace a finished request with the timings of the session's curl handle.
+static void trace_request(cpr::Session& sess, const std::string& fqmn, const TimingClock::time_point send_time)
+{
+    if (!trace_enabled())
+        return;
+
+    curl_off_t pretransfer_us = 0;
+    curl_off_t total_us = 0;
+
+    curl_easy_getinfo(sess.GetCurlHolder()->handle, CURLINFO_PRETRANSFER_TIME_T, &pretransfer_us);
+    curl_easy_getinfo(sess.GetCurlHolder()->handle, CURLINFO_TOTAL_TIME_T, &total_us);
+
+    trace_http_request(fqmn, send_time, std::chrono::microseconds{pretransfer_us}, std::chrono::microseconds{total_us});
+}
+
 std::optional<MessageResults> msg(cpr::Session& sess, const std::string& fqmn, std::vector<cpr::Pair> data)
 {
-    data.emplace_back("msg", fqmn);
-    sess.SetPayload(cpr::Payload{data.begin(), data.end()});
+    {
+        TraceSpan span{fqmn, "serialize"};
+        data.emplace_back("msg", fqmn);
+        sess.SetPayload(cpr::Payload{data.begin(), data.end()});
+    }
 
+    const auto send_time = TimingClock::now();
     const auto r = sess.Post();
 
+    trace_request(sess, fqmn, send_time);
+
+    const float elapsed = 1000.0f * static_cast<float>(r.elapsed);
+
     if (r.status_code != 200) {
         if (r.status_code > 0)
             spdlog::get("combined")->warn(r.status_line);
         else
             spdlog::get("combined")->error(r.error.message);
 
+        capture_msg(send_time, elapsed, -1, fqmn, data);
+
         return {};
     }
 
+    const auto parse_start = TimingClock::now();
     const auto json = nlohmann::json::parse(r.text);
+    trace_event(fqmn, "parse", parse_start, TimingClock::now());
+
+    capture_msg(send_time, elapsed, json["status"], fqmn, data);
 
     if (json["status"] != 0) {
         if (json["status"] > 0)
@@ -27,7 +76,41 @@ std::optional<MessageResults> msg(cpr::Session& sess, const std::string& fqmn, s
             spdlog::get("combined")->error("{} ({})", json["status_msg"], json["status"]);
     }
 
-    return {MessageResults{json["status"], 1000.0f * static_cast<float>(r.elapsed), json}};
+    return {MessageResults{json["status"], elapsed, json}};
+}
+
+// Send multiple messages in one request with the "performance.batch" envelope.
+// The results of the single messages are in json["results"], in the same order as the messages.
+std::optional<MessageResults> msg_batch(cpr::Session& sess, const std::vector<Message>& messages)
+{
+    std::string messages_json;
+
+    {
+        TraceSpan span{"performance.batch", "serialize"};
+        auto envelope = nlohmann::json::array();
+
+        for (const auto& message : messages) {
+            nlohmann::json in = nlohmann::json::object();
+
+            for (const auto& pair : message.data)
+                in[pair.key] = pair.value;
+
+            envelope.push_back({{"msg", message.fqmn}, {"in", in}});
+        }
+
+        messages_json = envelope.dump();
+    }
+
+    auto res = msg(sess, "performance.batch", {{"messages", messages_json}});
+
+    if (res.has_value() && res->status == 0) {
+        for (const auto& result : res->json["results"]) {
+            if (result["status"] != 0)
+                spdlog::get("combined")->warn("{}: status {}", result["msg"], result["status"]);
+        }
+    }
+
+    return res;
 }
 
 cpr::Session msg_login(const std::string& url, const std::string& user, const std::string& password, std::chrono::milliseconds timeout)
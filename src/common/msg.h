@@ -14,6 +14,12 @@ struct MessageResults {
     nlohmann::json json;
 };
 
+struct Message {
+    std::string fqmn;
+    std::vector<cpr::Pair> data;
+};
+
 std::optional<MessageResults> msg(cpr::Session& sess, const std::string& fqmn, std::vector<cpr::Pair> data);
+std::optional<MessageResults> msg_batch(cpr::Session& sess, const std::vector<Message>& messages);
 cpr::Session msg_login(const std::string& url, const std::string& user, const std::string& password, std::chrono::milliseconds timeout);
 void msg_logout(cpr::Session& sess);
@@ -0,0 +1,62 @@
+#include "multi_insert_buffer.h"
+
+#include <iterator>
+
+#include <fmt/chrono.h>
+#include <fmt/core.h>
+
+MultiInsertBuffer::MultiInsertBuffer(MYSQL* mysql, const std::string_view& table_name, int rows_per_insert, std::size_t max_text_length, bool explicit_ids)
+    : mysql_{mysql}
+{
+    buffer_ = fmt::format("INSERT INTO {} ({}time, text) VALUES ", table_name, explicit_ids ? "id, " : "");
+    prefix_length_ = buffer_.size();
+
+    // per row: "([<id>, ]'YYYY-MM-DD HH:MM:SS', '<escaped text>')," with up to two bytes per escaped character
+    const std::size_t max_row_length = 2 + (explicit_ids ? 21 : 0) + 19 + 4 + 2 * max_text_length + 1 + 3;
+    buffer_.reserve(prefix_length_ + static_cast<std::size_t>(rows_per_insert) * max_row_length);
+}
+
+void MultiInsertBuffer::add_row(std::time_t time, const std::string_view& text)
+{
+    if (num_rows_ > 0)
+        buffer_ += ',';
+
+    buffer_ += '(';
+    append_values(time, text);
+}
+
+void MultiInsertBuffer::add_row(std::int64_t id, std::time_t time, const std::string_view& text)
+{
+    if (num_rows_ > 0)
+        buffer_ += ',';
+
+    fmt::format_to(std::back_inserter(buffer_), "({}, ", id);
+    append_values(time, text);
+}
+
+void MultiInsertBuffer::append_values(std::time_t time, const std::string_view& text)
+{
+    // formatting the datetime is relatively expensive, so only do it once per second
+    if (time != last_time_) {
+        fmt::format_to_n(last_datetime_, sizeof(last_datetime_) - 1, "{:%Y-%m-%d %H:%M:%S}", fmt::gmtime(time));
+        last_time_ = time;
+    }
+
+    buffer_ += '\'';
+    buffer_.append(last_datetime_, sizeof(last_datetime_) - 1);
+    buffer_ += "', '";
+
+    const std::size_t pos = buffer_.size();
+    buffer_.resize(pos + 2 * text.size() + 1);
+    const auto len = mysql_real_escape_string(mysql_, buffer_.data() + pos, text.data(), text.size());
+    buffer_.resize(pos + len);
+
+    buffer_ += "')";
+    ++num_rows_;
+}
+
+void MultiInsertBuffer::clear()
+{
+    buffer_.resize(prefix_length_);
+    num_rows_ = 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+
+#include <mysql.h>
+
+// Builds multi-row INSERT statements in one reusable buffer, for any table with the time and text
+// columns of the "performance" table (like "performance_reset" and "performance_payload").
+// Values are escaped in place with mysql_real_escape_string(), so once the buffer has been
+// reserved, adding rows and sending batches does not allocate anymore.
+// With explicit_ids the statements also set the id column and rows have to be added with an id.
+class MultiInsertBuffer {
+public:
+    MultiInsertBuffer(MYSQL* mysql, const std::string_view& table_name, int rows_per_insert, std::size_t max_text_length, bool explicit_ids = false);
+
+    void add_row(std::time_t time, const std::string_view& text);
+    void add_row(std::int64_t id, std::time_t time, const std::string_view& text);
+    void clear();
+
+    [[nodiscard]] int num_rows() const { return num_rows_; }
+    [[nodiscard]] std::string_view statement() const { return buffer_; }
+
+private:
+    void append_values(std::time_t time, const std::string_view& text);
+
+    MYSQL* mysql_;
+    std::string buffer_;
+    std::size_t prefix_length_;
+    int num_rows_ = 0;
+
+    std::time_t last_time_ = -1;
+    char last_datetime_[20] = {};
+};
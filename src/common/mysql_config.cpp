@@ -0,0 +1,46 @@
+#include "mysql_config.h"
+
+#include <cstdlib>
+#include <fstream>
+
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+// Read JSON MySQL config file.
+//
+// Example "mysql.json":
+//
+//   {
+//       "user": "username",
+//       "password": "password",
+//       "database": "db_performance_test",
+//       "unix_socket": "/tmp/mysql.sock"
+//   }
+std::shared_ptr<sqlpp::mysql::connection_config> read_mysql_config(const std::string& db_config_filename)
+{
+    std::ifstream in(db_config_filename);
+    spdlog::info("open database config file: {}", db_config_filename);
+
+    if (!in.is_open()) {
+        spdlog::error("database config file not found: {}", db_config_filename);
+        std::exit(2);
+    }
+
+    nlohmann::json data;
+    in >> data;
+
+    auto config = std::make_shared<sqlpp::mysql::connection_config>();
+
+    if (!data["host"].empty()) config->host = data["host"].get<std::string>();
+    if (!data["user"].empty()) config->user = data["user"].get<std::string>();
+    if (!data["password"].empty()) config->password = data["password"].get<std::string>();
+    if (!data["database"].empty()) config->database = data["database"].get<std::string>();
+    if (!data["unix_socket"].empty()) config->unix_socket = data["unix_socket"].get<std::string>();
+    if (!data["charset"].empty()) config->charset = data["charset"].get<std::string>();
+    if (!data["port"].empty()) config->port = data["port"].get<unsigned int>();
+    if (!data["client_flag"].empty()) config->client_flag = data["client_flag"].get<unsigned long>();
+    if (!data["auto_reconnect"].empty()) config->auto_reconnect = data["auto_reconnect"].get<bool>();
+    if (!data["debug"].empty()) config->debug = data["debug"].get<bool>();
+
+    return config;
+}
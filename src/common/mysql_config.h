@@ -0,0 +1,8 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <sqlpp11/mysql/connection_config.h>
+
+std::shared_ptr<sqlpp::mysql::connection_config> read_mysql_config(const std::string& db_config_filename);
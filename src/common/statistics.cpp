@@ -1,6 +1,7 @@
 #include "statistics.h"
 
 #include <algorithm>
+#include <cmath>
 #include <numeric>
 
 #include <fmt/core.h>
@@ -28,8 +29,22 @@ float median(const std::vector<float>& values)
         return (sorted_values[sorted_values.size() / 2 - 1] + sorted_values[sorted_values.size() / 2]) / 2.0f;
 }
 
+// Nearest-rank percentile, p in the range of 0 to 100.
+float percentile(const std::vector<float>& values, float p)
+{
+    if (values.empty())
+        return 0.0f;
+
+    std::vector<float> sorted_values{values};
+    std::sort(sorted_values.begin(), sorted_values.end());
+
+    const auto rank = static_cast<std::size_t>(std::ceil(p / 100.0f * static_cast<float>(sorted_values.size())));
+
+    return sorted_values[std::clamp<std::size_t>(rank, 1, sorted_values.size()) - 1];
+}
+
 void show_stats(const std::string& url, const std::vector<float>& durations, const int num_errors)
 {
-    spdlog::get("combined")->info("{} --> successful: {}, errors: {}, mean: {:.2f}ms, median: {:.2f}ms",
+    spdlog::get("combined")->info("{} --> successful: {}, errors: {}, mean: {:.3f}ms, median: {:.3f}ms",
         url, durations.size(), num_errors, mean(durations), median(durations));
 }
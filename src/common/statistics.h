@@ -5,4 +5,5 @@
 
 float mean(const std::vector<float>& values);
 float median(const std::vector<float>& values);
+float percentile(const std::vector<float>& values, float p);
 void show_stats(const std::string& url, const std::vector<float>& durations, const int num_errors);
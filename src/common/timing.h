@@ -0,0 +1,23 @@
+#pragma once
+
+#include <chrono>
+
+// Clock for all duration measurements. high_resolution_clock may be an alias of the adjustable
+// system_clock, steady_clock is monotonic and has nanosecond resolution on Linux and macOS.
+using TimingClock = std::chrono::steady_clock;
+
+// Durations are kept in nanoseconds and shown as milliseconds with microsecond resolution ("{:.3f}ms").
+inline std::chrono::nanoseconds elapsed_ns(const TimingClock::time_point t0, const TimingClock::time_point t1)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0);
+}
+
+inline double to_ms(const std::chrono::nanoseconds duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+inline double elapsed_ms(const TimingClock::time_point t0, const TimingClock::time_point t1)
+{
+    return to_ms(elapsed_ns(t0, t1));
+}
@@ -0,0 +1,185 @@
+#include "trace.h"
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include <fmt/core.h>
+
+struct TraceEvent {
+    std::string name;
+    const char* phase;
+    std::int64_t start_ns;  // since the trace was started
+    std::int64_t duration_ns;
+    int track;              // -1 for spans of the thread
+};
+
+// Every thread records into its own buffer. The buffer mutex is only contended while
+// finish_trace() writes the file, so recording an event does not wait for other threads.
+struct ThreadTraceBuffer {
+    int tid;
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+};
+
+static std::atomic<bool> trace_active{false};
+static std::string trace_filename;
+static std::ofstream trace_file;
+static TimingClock::time_point trace_start;
+static std::mutex buffers_mutex;
+static std::vector<std::unique_ptr<ThreadTraceBuffer>> buffers;  // outlive their threads until the file is written
+static std::vector<ThreadTraceBuffer*> free_buffers;             // of finished threads, for the next new thread
+
+// Hands the buffer of a thread to the next new thread when it exits, so programs with a thread per
+// connection need as many buffers as threads run at the same time. Their events stay in the buffer
+// and share its tid, they do not overlap in time.
+struct ThreadTraceBufferLease {
+    ThreadTraceBuffer* buffer = nullptr;
+
+    ~ThreadTraceBufferLease()
+    {
+        if (buffer) {
+            std::lock_guard<std::mutex> lock{buffers_mutex};
+            free_buffers.push_back(buffer);
+        }
+    }
+};
+
+static ThreadTraceBuffer& thread_buffer()
+{
+    thread_local ThreadTraceBufferLease lease;
+
+    if (!lease.buffer) {
+        std::lock_guard<std::mutex> lock{buffers_mutex};
+
+        if (!free_buffers.empty()) {
+            lease.buffer = free_buffers.back();
+            free_buffers.pop_back();
+        } else {
+            buffers.push_back(std::make_unique<ThreadTraceBuffer>());
+            lease.buffer = buffers.back().get();
+            lease.buffer->tid = static_cast<int>(buffers.size());
+        }
+    }
+
+    return *lease.buffer;
+}
+
+static void append_json_string(std::string& out, const std::string_view s)
+{
+    for (const char c : s) {
+        if (c == '"' || c == '\\')
+            out += '\\';
+
+        if (static_cast<unsigned char>(c) < 0x20)
+            fmt::format_to(std::back_inserter(out), "\\u{:04x}", static_cast<int>(c));
+        else
+            out += c;
+    }
+}
+
+// Open the trace file right away, so a bad path fails before the test instead of after it.
+void start_trace(const std::string& filename)
+{
+    trace_file.open(filename, std::ios::trunc);
+
+    if (!trace_file.is_open())
+        throw std::runtime_error{fmt::format("unable to open trace file: {}", filename)};
+
+    trace_filename = filename;
+    trace_start = TimingClock::now();
+    trace_active = true;
+}
+
+bool trace_enabled()
+{
+    return trace_active;
+}
+
+void trace_event(const std::string_view name, const char* phase, const TimingClock::time_point start, const TimingClock::time_point end)
+{
+    if (!trace_enabled())
+        return;
+
+    auto& buffer = thread_buffer();
+    std::lock_guard<std::mutex> lock{buffer.mutex};
+
+    buffer.events.push_back(TraceEvent{std::string{name}, phase, elapsed_ns(trace_start, start).count(), elapsed_ns(start, end).count(), -1});
+}
+
+void trace_async_event(const std::string_view name, const char* phase, const int track, const TimingClock::time_point start, const TimingClock::time_point end)
+{
+    if (!trace_enabled())
+        return;
+
+    auto& buffer = thread_buffer();
+    std::lock_guard<std::mutex> lock{buffer.mutex};
+
+    buffer.events.push_back(TraceEvent{std::string{name}, phase, elapsed_ns(trace_start, start).count(), elapsed_ns(start, end).count(), track});
+}
+
+void trace_http_request(const std::string_view name, const TimingClock::time_point send_time, const std::chrono::microseconds pretransfer_time, const std::chrono::microseconds total_time, const int track)
+{
+    if (!trace_enabled())
+        return;
+
+    const auto transfer_start = send_time + pretransfer_time;
+    const auto transfer_end = send_time + total_time;
+
+    if (track < 0) {
+        trace_event(name, "send", send_time, transfer_start);
+        trace_event(name, "wait", transfer_start, transfer_end);
+    } else {
+        trace_async_event(name, "send", track, send_time, transfer_start);
+        trace_async_event(name, "wait", track, transfer_start, transfer_end);
+    }
+}
+
+// Stop recording and write all events to the trace file.
+void finish_trace()
+{
+    if (!trace_active.exchange(false))
+        return;
+
+    auto& out = trace_file;
+    std::lock_guard<std::mutex> lock{buffers_mutex};
+    std::string name;
+    std::string line;
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << R"({"name":"process_name","ph":"M","pid":1,"tid":0,"args":{"name":"performance test"}})";
+
+    for (const auto& buffer : buffers) {
+        std::lock_guard<std::mutex> buffer_lock{buffer->mutex};
+
+        for (const auto& event : buffer->events) {
+            const double ts = static_cast<double>(event.start_ns) / 1000.0;
+            const double dur = static_cast<double>(event.duration_ns) / 1000.0;
+
+            name.clear();
+            append_json_string(name, event.name);
+            line.clear();
+
+            // async events are a begin/end pair with an id per thread and track
+            if (event.track < 0)
+                fmt::format_to(std::back_inserter(line), R"(,{}{{"name":"{}","cat":"{}","ph":"X","ts":{:.3f},"dur":{:.3f},"pid":1,"tid":{}}})",
+                    '\n', name, event.phase, ts, dur, buffer->tid);
+            else
+                fmt::format_to(std::back_inserter(line), R"(,{0}{{"name":"{1}","cat":"{2}","ph":"b","id":"{3}.{4}","ts":{5:.3f},"pid":1,"tid":{3}}},{0}{{"name":"{1}","cat":"{2}","ph":"e","id":"{3}.{4}","ts":{6:.3f},"pid":1,"tid":{3}}})",
+                    '\n', name, event.phase, buffer->tid, event.track, ts, ts + dur);
+
+            out << line;
+        }
+    }
+
+    out << "\n]}\n";
+    out.close();
+
+    if (!out)
+        throw std::runtime_error{fmt::format("unable to write trace file: {}", trace_filename)};
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "timing.h"
+
+// Trace export in Chrome trace-event format, to open in Perfetto or chrome://tracing.
+// Every event is a span on the thread that recorded it, its category is the phase:
+// "generate", "serialize", "send", "wait" or "parse". Overlapping spans of one thread
+// (like requests in flight on multiple connections) are async events on their own track.
+void start_trace(const std::string& filename);
+void finish_trace();
+bool trace_enabled();
+void trace_event(std::string_view name, const char* phase, TimingClock::time_point start, TimingClock::time_point end);
+void trace_async_event(std::string_view name, const char* phase, int track, TimingClock::time_point start, TimingClock::time_point end);
+
+// Trace an HTTP request as send (until the request goes out, including connect and TLS handshake) and wait
+// (until the response is complete), from curl's CURLINFO_PRETRANSFER_TIME_T and CURLINFO_TOTAL_TIME_T.
+// Requests that overlap on one thread pass a track and are traced as async events.
+void trace_http_request(std::string_view name, TimingClock::time_point send_time, std::chrono::microseconds pretransfer_time, std::chrono::microseconds total_time, int track = -1);
+
+// Records a span from construction to destruction. The name has to outlive the span.
+class TraceSpan {
+public:
+    TraceSpan(const std::string_view name, const char* phase)
+        : name_{name}, phase_{phase}, start_{trace_enabled() ? TimingClock::now() : TimingClock::time_point{}} { }
+
+    ~TraceSpan()
+    {
+        if (trace_enabled())
+            trace_event(name_, phase_, start_, TimingClock::now());
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    std::string_view name_;
+    const char* phase_;
+    TimingClock::time_point start_;
+};
@@ -120,7 +120,7 @@ int main(int argc, char* argv[])
 {
     const auto [logfile_name, csvfile_name] = eval_args(argc, argv);
 
-    auto [re, mcontext, jit_stack, match_data] = init_pcre2(R"(\[([^]]+)\] \[info\] ([^ ]+) --> (\d+)ms)");
+    auto [re, mcontext, jit_stack, match_data] = init_pcre2(R"(\[([^]]+)\] \[info\] ([^ ]+) --> (\d+(?:\.\d+)?)ms)");
 
     std::ifstream in{logfile_name};
     std::ofstream out{csvfile_name};
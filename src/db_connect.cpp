@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <latch>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <clipp.h>
+#include <fmt/core.h>
+#include <mysql.h>
+#include <spdlog/spdlog.h>
+
+#include "common/combined_logger.h"
+#include "common/mariadb.h"
+#include "common/mysql_config.h"
+#include "common/statistics.h"
+#include "common/timing.h"
+#include "common/trace.h"
+#include "common/usage.h"
+
+enum class ConnectMode {
+    tcp,
+    tls,
+    socket,
+    pooled
+};
+
+const char* connect_mode_name(const ConnectMode mode)
+{
+    switch (mode) {
+        case ConnectMode::tcp: return "tcp";
+        case ConnectMode::tls: return "tls";
+        case ConnectMode::socket: return "socket";
+        case ConnectMode::pooled: return "pooled";
+    }
+
+    return "unknown";
+}
+
+// Open and authenticate a new connection over the given transport, like a PHP worker does for every request.
+// The transport is forced with MYSQL_OPT_PROTOCOL, otherwise libmariadb uses the socket for "localhost".
+MariaDBConnection open_connection(const sqlpp::mysql::connection_config& config, const ConnectMode mode)
+{
+    MariaDBConnection mysql{mysql_init(nullptr), &mysql_close};
+
+    if (!mysql)
+        throw std::runtime_error{"MariaDB unable to initialize connection"};
+
+    const unsigned int protocol = mode == ConnectMode::socket ? MYSQL_PROTOCOL_SOCKET : MYSQL_PROTOCOL_TCP;
+    mysql_options(mysql.get(), MYSQL_OPT_PROTOCOL, &protocol);
+
+    if (mode == ConnectMode::tls) {
+        const my_bool enforce = 1;
+        mysql_options(mysql.get(), MYSQL_OPT_SSL_ENFORCE, &enforce);
+    }
+
+    const auto optional_c_str = [](const std::string& s) { return s.empty() ? nullptr : s.c_str(); };
+    const char* host = mode == ConnectMode::socket ? nullptr : (config.host.empty() ? "localhost" : config.host.c_str());
+    const char* unix_socket = mode == ConnectMode::socket ? optional_c_str(config.unix_socket) : nullptr;
+
+    if (!mysql_real_connect(mysql.get(), host, optional_c_str(config.user), optional_c_str(config.password),
+            optional_c_str(config.database), config.port, unix_socket, config.client_flag))
+        throw std::runtime_error{fmt::format("MariaDB unable to connect: {}", mysql_error(mysql.get()))};
+
+    return mysql;
+}
+
+// Open num_connects connections from num_threads threads and measure the handshake latency (connect and
+// authentication) of every connection. Closing is not part of the latency, but of the connects/s.
+// "pooled" is the baseline of a connection pool: every thread keeps one connection and resets its session
+// state with COM_RESET_CONNECTION instead of reconnecting.
+void test_connect(const std::shared_ptr<sqlpp::mysql::connection_config> config, const ConnectMode mode, const std::int64_t num_connects, const int num_threads)
+{
+    const auto name = connect_mode_name(mode);
+
+    spdlog::info("run test: {} connects over {} ({} threads)", num_connects, name, num_threads);
+
+    // check the transport once, so a missing socket or a server without TLS fails fast
+    try {
+        auto mysql = mode == ConnectMode::pooled ? mariadb_connect(*config) : open_connection(*config, mode);
+
+        if (mode == ConnectMode::tls)
+            spdlog::info("TLS cipher: {}", mysql_get_ssl_cipher(mysql.get()) ? mysql_get_ssl_cipher(mysql.get()) : "none");
+    } catch (const std::exception& e) {
+        spdlog::get("combined")->error("test connect {}: {}", name, e.what());
+        return;
+    }
+
+    std::atomic<std::int64_t> num_claimed_connects{0};
+    std::atomic<int> num_errors{0};
+    std::vector<std::vector<float>> thread_latencies(static_cast<std::size_t>(num_threads));
+    std::latch ready{num_threads + 1};
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t] {
+            auto& latencies = thread_latencies[static_cast<std::size_t>(t)];
+            MariaDBConnection pooled{nullptr, &mysql_close};
+
+            try {
+                if (mode == ConnectMode::pooled)
+                    pooled = mariadb_connect(*config);
+            } catch (const std::exception& e) {
+                spdlog::get("combined")->error(e.what());
+                ++num_errors;
+                ready.arrive_and_wait();
+                return;
+            }
+
+            ready.arrive_and_wait();
+
+            while (num_claimed_connects.fetch_add(1) < num_connects) {
+                const auto t0 = TimingClock::now();
+
+                try {
+                    if (mode == ConnectMode::pooled) {
+                        if (mysql_reset_connection(pooled.get()))
+                            throw std::runtime_error{fmt::format("MariaDB unable to reset connection: {}", mysql_error(pooled.get()))};
+
+                        const auto t1 = TimingClock::now();
+                        latencies.push_back(static_cast<float>(elapsed_ms(t0, t1)));
+                        trace_event("reset", "wait", t0, t1);
+                    } else {
+                        auto mysql = open_connection(*config, mode);
+                        const auto t1 = TimingClock::now();
+                        latencies.push_back(static_cast<float>(elapsed_ms(t0, t1)));
+                        trace_event(name, "wait", t0, t1);
+                    }
+                } catch (const std::exception& e) {
+                    spdlog::get("combined")->error(e.what());
+                    ++num_errors;
+                }
+            }
+        });
+    }
+
+    ready.arrive_and_wait();
+
+    const auto t0 = TimingClock::now();
+
+    for (auto& thread : threads)
+        thread.join();
+
+    const auto t1 = TimingClock::now();
+
+    std::vector<float> latencies;
+
+    for (const auto& thread_latency : thread_latencies)
+        latencies.insert(latencies.end(), thread_latency.begin(), thread_latency.end());
+
+    spdlog::get("combined")->info("test connect {}: {} connects in {:.3f}ms, {:.0f} connects/s, errors: {}, mean: {:.3f}ms, p50: {:.3f}ms, p95: {:.3f}ms, p99: {:.3f}ms, max: {:.3f}ms (threads: {})",
+        name, latencies.size(), elapsed_ms(t0, t1), static_cast<double>(latencies.size()) / (elapsed_ms(t0, t1) / 1000.0), num_errors.load(),
+        mean(latencies), percentile(latencies, 50.0f), percentile(latencies, 95.0f), percentile(latencies, 99.0f), percentile(latencies, 100.0f), num_threads);
+}
+
+struct Options {
+    bool run_tcp = false;
+    bool run_tls = false;
+    bool run_socket = false;
+    bool run_pooled = false;
+    std::string db_config_filename{"mysql.json"};
+    std::string logfile_name{"logs/db_connect.log"};
+    std::string trace_filename;
+    std::int64_t num_connects = 1000;
+    int num_threads = 1;
+};
+
+Options eval_args(int argc, char* argv[])
+{
+    const auto description = "Run database connection benchmarks.";
+    const auto example = "--tcp --socket --connects 10000 --threads 8 --config ../mysql.json";
+    Options opts;
+    bool run_all = true;
+    bool show_help = false;
+    auto log_level = spdlog::level::warn;
+
+    auto cli = (
+        (clipp::option("--tcp").set(opts.run_tcp).set(run_all, false)
+            % "run test: connect over TCP",
+         clipp::option("--tls").set(opts.run_tls).set(run_all, false)
+            % "run test: connect over TCP with TLS",
+         clipp::option("--socket").set(opts.run_socket).set(run_all, false)
+            % "run test: connect over the Unix socket (\"unix_socket\" from the config or the default socket)",
+         clipp::option("--pooled").set(opts.run_pooled).set(run_all, false)
+            % "run test: reset a kept open connection instead of reconnecting, like a connection pool") |
+        clipp::option("--all").set(run_all)
+            % "run all tests (default)",
+        (clipp::option("--config") & clipp::value("filename", opts.db_config_filename))
+            % fmt::format("database connection config (default: {})", opts.db_config_filename),
+        (clipp::option("--connects") & clipp::value("num_connects", opts.num_connects))
+            % fmt::format("number of connects per test (default: {})", opts.num_connects),
+        (clipp::option("--threads") & clipp::integer("num_threads", opts.num_threads))
+            % fmt::format("number of threads connecting concurrently (default: {})", opts.num_threads),
+        (clipp::option("--log") & clipp::value("logfile", opts.logfile_name))
+            % fmt::format("logfile name (default: {})", opts.logfile_name),
+        (clipp::option("--trace") & clipp::value("tracefile", opts.trace_filename))
+            % "write a trace file in Chrome trace-event format (open it in Perfetto)",
+        clipp::option("-h", "--help").set(show_help)
+            % "show help",
+        clipp::option("-v", "--verbose").set(log_level, spdlog::level::info)
+            % "show verbose output"
+    );
+
+    if (!clipp::parse(argc, argv, cli))
+        show_usage_and_exit(cli, argv[0], description, example);
+
+    spdlog::set_level(log_level);
+    spdlog::info("command line option --tcp: {}", opts.run_tcp);
+    spdlog::info("command line option --tls: {}", opts.run_tls);
+    spdlog::info("command line option --socket: {}", opts.run_socket);
+    spdlog::info("command line option --pooled: {}", opts.run_pooled);
+    spdlog::info("command line option --all: {}", run_all);
+    spdlog::info("command line option --config: {}", opts.db_config_filename);
+    spdlog::info("command line option --connects: {}", opts.num_connects);
+    spdlog::info("command line option --threads: {}", opts.num_threads);
+    spdlog::info("command line option --log: {}", opts.logfile_name);
+    spdlog::info("command line option --trace: {}", opts.trace_filename);
+
+    if (run_all) {
+        opts.run_tcp = true;
+        opts.run_tls = true;
+        opts.run_socket = true;
+        opts.run_pooled = true;
+    }
+
+    if (show_help || opts.num_connects < 1 || opts.num_threads < 1)
+        show_usage_and_exit(cli, argv[0], description, example);
+
+    return opts;
+}
+
+int main(int argc, char* argv[])
+{
+    const auto opts = eval_args(argc, argv);
+    const auto config = read_mysql_config(opts.db_config_filename);
+
+    create_combined_logger(opts.logfile_name);
+
+    if (!opts.trace_filename.empty())
+        start_trace(opts.trace_filename);
+
+    if (opts.run_tcp)
+        test_connect(config, ConnectMode::tcp, opts.num_connects, opts.num_threads);
+
+    if (opts.run_tls)
+        test_connect(config, ConnectMode::tls, opts.num_connects, opts.num_threads);
+
+    if (opts.run_socket)
+        test_connect(config, ConnectMode::socket, opts.num_connects, opts.num_threads);
+
+    if (opts.run_pooled)
+        test_connect(config, ConnectMode::pooled, opts.num_connects, opts.num_threads);
+
+    finish_trace();
+}
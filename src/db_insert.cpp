@@ -1,62 +1,47 @@
+#include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <chrono>
-#include <fstream>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <latch>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <random>
+#include <span>
 #include <string>
 #include <string_view>
 #include <thread>
-#include <tuple>
+#include <vector>
+
+#include <sys/resource.h>
 
 #include <clipp.h>
+#include <fmt/chrono.h>
 #include <fmt/core.h>
-#include <nlohmann/json.hpp>
+#include <fmt/ranges.h>
+#include <errmsg.h>
+#include <mysqld_error.h>
 #include <spdlog/spdlog.h>
 #include <sqlpp11/mysql/mysql.h>
 #include <sqlpp11/sqlpp11.h>
 
 #include "performance.h"
+#include "common/async_insert.h"
 #include "common/combined_logger.h"
+#include "common/generic_insert.h"
+#include "common/mariadb.h"
+#include "common/multi_insert_buffer.h"
+#include "common/mysql_config.h"
+#include "common/statistics.h"
+#include "common/timing.h"
+#include "common/trace.h"
 #include "common/usage.h"
 
 using namespace std::chrono_literals;
 
-// Read JSON MySQL config file.
-//
-// Example "mysql.json":
-//
-//   {
-//       "user": "username",
-//       "password": "password",
-//       "database": "db_performance_test",
-//       "unix_socket": "/tmp/mysql.sock"
-//   }
-std::shared_ptr<sqlpp::mysql::connection_config> read_mysql_config(const std::string& db_config_filename)
-{
-    std::ifstream in(db_config_filename);
-    spdlog::info("open database config file: {}", db_config_filename);
-
-    if (!in.is_open()) {
-        spdlog::error("database config file not found: {}", db_config_filename);
-        std::exit(2);
-    }
-
-    nlohmann::json data;
-    in >> data;
-
-    auto config = std::make_shared<sqlpp::mysql::connection_config>();
-
-    if (!data["host"].empty()) config->host = data["host"].get<std::string>();
-    if (!data["user"].empty()) config->user = data["user"].get<std::string>();
-    if (!data["password"].empty()) config->password = data["password"].get<std::string>();
-    if (!data["database"].empty()) config->database = data["database"].get<std::string>();
-    if (!data["unix_socket"].empty()) config->unix_socket = data["unix_socket"].get<std::string>();
-    if (!data["charset"].empty()) config->charset = data["charset"].get<std::string>();
-    if (!data["port"].empty()) config->port = data["port"].get<unsigned int>();
-    if (!data["client_flag"].empty()) config->client_flag = data["client_flag"].get<unsigned long>();
-    if (!data["auto_reconnect"].empty()) config->auto_reconnect = data["auto_reconnect"].get<bool>();
-    if (!data["debug"].empty()) config->debug = data["debug"].get<bool>();
-
-    return config;
-}
-
 sqlpp::mysql::connection connect_database(const std::shared_ptr<sqlpp::mysql::connection_config> config)
 {
     spdlog::info("connecting to database \"{}\"", config->database);
@@ -70,98 +55,1162 @@ void drop_table(sqlpp::mysql::connection& db, const std::string_view& table_name
     db.execute(fmt::format("DROP TABLE IF EXISTS {}", table_name));
 }
 
-void create_table(sqlpp::mysql::connection& db, const std::string_view& table_name)
+std::string create_table_statement(const std::string_view& table_name)
 {
-    spdlog::info("create table \"{}\"", table_name);
-
-    db.execute(fmt::format(
-        "CREATE TABLE {} ("
-        "    id     INT NOT NULL AUTO_INCREMENT,"
+    return fmt::format(
+        "CREATE TABLE IF NOT EXISTS {} ("
+        "    id     BIGINT NOT NULL AUTO_INCREMENT,"
         "    time   DATETIME NOT NULL,"
         "    text   VARCHAR(255) NOT NULL,"
         "    PRIMARY KEY (id)"
         ") CHARSET=utf8 COLLATE=utf8_unicode_ci",
-        table_name));
+        table_name);
 }
 
-void test_single_inserts(sqlpp::mysql::connection& db, const int num_insert_rows)
+void create_table(sqlpp::mysql::connection& db, const std::string_view& table_name)
+{
+    spdlog::info("create table \"{}\"", table_name);
+
+    db.execute(create_table_statement(table_name));
+}
+
+struct SeedTarget {
+    std::int64_t rows;
+    std::int64_t bytes;
+};
+
+// Parse a seed target, either a number of rows ("1000000") or a table size ("500MB", "100GB").
+std::optional<SeedTarget> parse_seed_target(const std::string_view& s)
+{
+    std::int64_t value = 0;
+    const auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+
+    if (ec != std::errc{} || value < 1)
+        return {};
+
+    const std::string_view unit{ptr, static_cast<std::size_t>(s.data() + s.size() - ptr)};
+
+    if (unit.empty())
+        return SeedTarget{value, 0};
+    if (unit == "MB" || unit == "M")
+        return SeedTarget{0, value * 1024 * 1024};
+    if (unit == "GB" || unit == "G")
+        return SeedTarget{0, value * 1024 * 1024 * 1024};
+
+    return {};
+}
+
+std::int64_t table_size(MYSQL* mysql, const std::string_view& table_name)
+{
+    const auto value = mariadb_query_value(mysql, fmt::format(
+        "SELECT data_length + index_length FROM information_schema.tables WHERE table_schema = DATABASE() AND table_name = '{}'", table_name));
+
+    return value.empty() ? 0 : std::stoll(value);
+}
+
+// Next value of the splitmix64 generator. Cheap to seed for every row and, unlike the distributions of
+// <random>, it gives the same values with every compiler and standard library.
+std::uint64_t splitmix64(std::uint64_t& state)
+{
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+// Fill the table with deterministic pseudo-random rows as fast as possible, using one connection per thread
+// and large multi inserts without unique and foreign key checks. Rows are inserted with explicit ids and the
+// values of every row are derived from its id with splitmix64, so the content of a row only depends on its id
+// and not on the number of threads, the batch size or the platform. Seeding continues after the highest existing id, so a row target
+// fills the table up to that id and a kept table is only topped up.
+// A size target is checked every few seconds, after updating the table statistics with ANALYZE TABLE.
+void seed_table(const std::shared_ptr<sqlpp::mysql::connection_config> config, const SeedTarget& target, const int num_threads, const int num_rows_per_multi_insert)
+{
+    auto mysql = mariadb_connect(*config);
+    const std::int64_t max_id = std::stoll(mariadb_query_value(mysql.get(), "SELECT COALESCE(MAX(id), 0) FROM performance"));
+
+    if (target.rows > 0)
+        spdlog::info("seed table \"performance\" up to {} rows, starting after id {} ({} threads)", target.rows, max_id, num_threads);
+    else
+        spdlog::info("seed table \"performance\" to {:.1f}GB, starting after id {} ({} threads)", static_cast<double>(target.bytes) / (1024.0 * 1024.0 * 1024.0), max_id, num_threads);
+
+    const std::int64_t max_rows = target.rows > 0 ? target.rows : std::numeric_limits<std::int64_t>::max();
+    const std::time_t base_time = 1609459200;  // 2021-01-01 00:00:00 UTC
+
+    std::atomic<std::int64_t> num_claimed_rows{max_id};
+    std::atomic<std::int64_t> num_rows{0};
+    std::atomic<int> num_running_threads{num_threads};
+    std::atomic<bool> target_size_reached{false};
+    std::vector<std::thread> threads;
+
+    if (target.bytes > 0) {
+        mariadb_query_value(mysql.get(), "ANALYZE TABLE performance");
+        target_size_reached = table_size(mysql.get(), "performance") >= target.bytes;
+    }
+
+    auto t0 = TimingClock::now();
+
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&] {
+            auto thread_mysql = mariadb_connect(*config);
+            mariadb_query(thread_mysql.get(), "SET SESSION unique_checks = 0, foreign_key_checks = 0");
+
+            MultiInsertBuffer multi_insert{thread_mysql.get(), "performance", num_rows_per_multi_insert, 255, true};
+            char text[256];
+
+            while (!target_size_reached) {
+                const std::int64_t first_row = num_claimed_rows.fetch_add(num_rows_per_multi_insert);
+
+                if (first_row >= max_rows)
+                    break;
+
+                const auto batch_start = TimingClock::now();
+                const auto batch_rows = std::min<std::int64_t>(num_rows_per_multi_insert, max_rows - first_row);
+
+                for (std::int64_t id = first_row + 1; id <= first_row + batch_rows; ++id) {
+                    auto state = static_cast<std::uint64_t>(id);
+                    const std::uint64_t r = splitmix64(state);
+
+                    // 16-255 letters within a year
+                    const auto len = static_cast<std::size_t>(16 + r % 240);
+                    const auto time = base_time + static_cast<std::time_t>((r >> 8) % (365 * 24 * 3600));
+
+                    // 13 letters from every 64-bit value
+                    for (std::size_t c = 0; c < len; c += 13) {
+                        std::uint64_t letters = splitmix64(state);
+
+                        for (std::size_t l = c; l < std::min<std::size_t>(c + 13, len); ++l, letters /= 26)
+                            text[l] = static_cast<char>('a' + letters % 26);
+                    }
+
+                    multi_insert.add_row(id, time, {text, len});
+                }
+
+                trace_event("rows", "serialize", batch_start, TimingClock::now());
+                mariadb_query(thread_mysql.get(), multi_insert.statement());
+                multi_insert.clear();
+                num_rows += batch_rows;
+            }
+
+            --num_running_threads;
+        });
+    }
+
+    auto last_check = TimingClock::now();
+
+    while (num_running_threads > 0) {
+        std::this_thread::sleep_for(100ms);
+
+        if (TimingClock::now() - last_check < 5s)
+            continue;
+
+        last_check = TimingClock::now();
+
+        if (target.bytes > 0) {
+            mariadb_query_value(mysql.get(), "ANALYZE TABLE performance");
+            const auto size = table_size(mysql.get(), "performance");
+
+            spdlog::info("seed: {} rows, {:.1f}MB", num_rows.load(), static_cast<double>(size) / (1024.0 * 1024.0));
+
+            if (size >= target.bytes)
+                target_size_reached = true;
+        } else {
+            spdlog::info("seed: {} rows", num_rows.load());
+        }
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    auto t1 = TimingClock::now();
+
+    spdlog::get("combined")->info("seed: {} rows in {:.3f}ms (threads: {}, rows per insert: {})", num_rows.load(), elapsed_ms(t0, t1), num_threads, num_rows_per_multi_insert);
+}
+
+void test_single_inserts(sqlpp::mysql::connection& db, const std::int64_t num_insert_rows)
 {
     spdlog::info("run test: single inserts for every row");
     std::this_thread::sleep_for(1s);
 
-    auto t0 = std::chrono::high_resolution_clock::now();
+    auto t0 = TimingClock::now();
 
     Performance::Performance performance{};
 
-    for (int i = 0; i < num_insert_rows; ++i) {
+    for (std::int64_t i = 0; i < num_insert_rows; ++i) {
+        TraceSpan span{"INSERT (sqlpp11)", "send"};
         db(sqlpp::insert_into(performance).set(
             performance.time = std::chrono::system_clock::now(),
             performance.text = fmt::format("single insert, row {}/{}", i+1, num_insert_rows)));
     }
 
-    auto t1 = std::chrono::high_resolution_clock::now();
+    auto t1 = TimingClock::now();
 
-    spdlog::get("combined")->info("test single: {} rows in {}ms", num_insert_rows, std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count());
+    spdlog::get("combined")->info("test single: {} rows in {:.3f}ms", num_insert_rows, elapsed_ms(t0, t1));
 }
 
-void test_multiple_inserts(sqlpp::mysql::connection& db, const int num_insert_rows, const int num_rows_per_multi_insert)
+std::chrono::nanoseconds test_multiple_inserts(sqlpp::mysql::connection& db, const std::int64_t num_insert_rows, const int num_rows_per_multi_insert)
 {
     spdlog::info("run test: insert multiple rows in one request");
     std::this_thread::sleep_for(1s);
 
-    auto t0 = std::chrono::high_resolution_clock::now();
+    auto t0 = TimingClock::now();
 
     Performance::Performance performance{};
     auto multi_insert = sqlpp::insert_into(performance).columns(performance.time, performance.text);
+    auto batch_start = TimingClock::now();
+
+    const auto send_multi_insert = [&] {
+        trace_event("rows", "generate", batch_start, TimingClock::now());
+        {
+            TraceSpan span{"INSERT (sqlpp11)", "send"};
+            db(multi_insert);
+        }
+        multi_insert.values._data._insert_values.clear();
+        batch_start = TimingClock::now();
+    };
 
-    for (int i = 0; i < num_insert_rows; ++i) {
+    for (std::int64_t i = 0; i < num_insert_rows; ++i) {
         multi_insert.values.add(
             performance.time = std::chrono::system_clock::now(),
             performance.text = fmt::format("multi insert, row {}/{}", i+1, num_insert_rows));
 
-        if (std::ssize(multi_insert.values._data._insert_values) == num_rows_per_multi_insert) {
-            db(multi_insert);
-            multi_insert.values._data._insert_values.clear();
+        if (std::ssize(multi_insert.values._data._insert_values) == num_rows_per_multi_insert)
+            send_multi_insert();
+    }
+
+    if (!multi_insert.values._data._insert_values.empty())
+        send_multi_insert();
+
+    auto t1 = TimingClock::now();
+
+    const auto ns = elapsed_ns(t0, t1);
+
+    spdlog::get("combined")->info("test multi: {} rows in {:.3f}ms (rows per insert: {})", num_insert_rows, to_ms(ns), num_rows_per_multi_insert);
+
+    return ns;
+}
+
+std::chrono::nanoseconds test_multi_statement_inserts(const std::shared_ptr<sqlpp::mysql::connection_config> config, const std::int64_t num_insert_rows, const int num_statements_per_request)
+{
+    spdlog::info("run test: multiple single-row inserts in one request");
+
+    auto mysql = mariadb_connect(*config, CLIENT_MULTI_STATEMENTS);
+
+    std::this_thread::sleep_for(1s);
+
+    auto t0 = TimingClock::now();
+
+    std::string request;
+    int num_statements = 0;
+    auto batch_start = TimingClock::now();
+
+    for (std::int64_t i = 0; i < num_insert_rows; ++i) {
+        request += fmt::format("INSERT INTO performance (time, text) VALUES ('{:%Y-%m-%d %H:%M:%S}', 'multi statement insert, row {}/{}');",
+            fmt::gmtime(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now())), i+1, num_insert_rows);
+
+        if (++num_statements == num_statements_per_request) {
+            trace_event("statements", "generate", batch_start, TimingClock::now());
+            mariadb_multi_query(mysql.get(), request);
+            request.clear();
+            num_statements = 0;
+            batch_start = TimingClock::now();
+        }
+    }
+
+    if (num_statements > 0) {
+        trace_event("statements", "generate", batch_start, TimingClock::now());
+        mariadb_multi_query(mysql.get(), request);
+    }
+
+    auto t1 = TimingClock::now();
+
+    const auto ns = elapsed_ns(t0, t1);
+
+    spdlog::get("combined")->info("test multi-statement: {} rows in {:.3f}ms (statements per request: {})", num_insert_rows, to_ms(ns), num_statements_per_request);
+
+    return ns;
+}
+
+// Run the multi-statement test and the multi insert test with the same batch size and compare both.
+// A multi insert result of the same batch size (like from --multi in the same run) is reused instead of running it again.
+void compare_multi_statement_with_multiple_inserts(sqlpp::mysql::connection& db, const std::shared_ptr<sqlpp::mysql::connection_config> config, const std::int64_t num_insert_rows, const int batch_size,
+    const std::optional<std::chrono::nanoseconds> measured_multi_ns)
+{
+    const auto multi_statement_ns = test_multi_statement_inserts(config, num_insert_rows, batch_size);
+
+    if (measured_multi_ns.has_value())
+        spdlog::info("compare multi-statement vs. multi: reusing the result of the multi insert test");
+
+    const auto multi_ns = measured_multi_ns.has_value() ? *measured_multi_ns : test_multiple_inserts(db, num_insert_rows, batch_size);
+
+    spdlog::get("combined")->info("compare multi-statement vs. multi: {:.3f}ms vs. {:.3f}ms, speedup of multi: {:.2f}x (batch size: {})",
+        to_ms(multi_statement_ns), to_ms(multi_ns), static_cast<double>(multi_statement_ns.count()) / static_cast<double>(std::max<std::chrono::nanoseconds::rep>(multi_ns.count(), 1)), batch_size);
+}
+
+void test_raw_multiple_inserts(const std::shared_ptr<sqlpp::mysql::connection_config> config, const std::int64_t num_insert_rows, const int num_rows_per_multi_insert)
+{
+    spdlog::info("run test: insert multiple rows in one request without query builder");
+
+    auto mysql = mariadb_connect(*config);
+    MultiInsertBuffer multi_insert{mysql.get(), "performance", num_rows_per_multi_insert, 255};
+    char text[256];
+
+    std::this_thread::sleep_for(1s);
+
+    auto t0 = TimingClock::now();
+    auto batch_start = t0;
+
+    for (std::int64_t i = 0; i < num_insert_rows; ++i) {
+        const auto len = fmt::format_to_n(text, sizeof(text), "raw multi insert, row {}/{}", i+1, num_insert_rows).size;
+        multi_insert.add_row(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()), {text, std::min(len, sizeof(text))});
+
+        if (multi_insert.num_rows() == num_rows_per_multi_insert) {
+            trace_event("rows", "serialize", batch_start, TimingClock::now());
+            mariadb_query(mysql.get(), multi_insert.statement());
+            multi_insert.clear();
+            batch_start = TimingClock::now();
         }
     }
 
+    if (multi_insert.num_rows() > 0) {
+        trace_event("rows", "serialize", batch_start, TimingClock::now());
+        mariadb_query(mysql.get(), multi_insert.statement());
+    }
+
+    auto t1 = TimingClock::now();
+
+    spdlog::get("combined")->info("test raw multi: {} rows in {:.3f}ms (rows per insert: {})", num_insert_rows, elapsed_ms(t0, t1), num_rows_per_multi_insert);
+}
+
+// Measure only the client-side cost of building multi insert statements (nothing is sent to the database):
+// sqlpp11 expression tree and serialization versus the raw reusable buffer.
+void test_serialization(sqlpp::mysql::connection& db, const std::shared_ptr<sqlpp::mysql::connection_config> config, const std::int64_t num_insert_rows, const int num_rows_per_multi_insert)
+{
+    spdlog::info("run test: client-side cost of building multi insert statements");
+
+    std::size_t num_bytes = 0;
+
+    auto t0 = TimingClock::now();
+
+    Performance::Performance performance{};
+    auto multi_insert = sqlpp::insert_into(performance).columns(performance.time, performance.text);
+
+    const auto serialize_sqlpp = [&] {
+        TraceSpan span{"INSERT (sqlpp11)", "serialize"};
+        sqlpp::mysql::serializer_t context{db};
+        sqlpp::serialize(multi_insert, context);
+        num_bytes += context.str().size();
+        multi_insert.values._data._insert_values.clear();
+    };
+
+    for (std::int64_t i = 0; i < num_insert_rows; ++i) {
+        multi_insert.values.add(
+            performance.time = std::chrono::system_clock::now(),
+            performance.text = fmt::format("multi insert, row {}/{}", i+1, num_insert_rows));
+
+        if (std::ssize(multi_insert.values._data._insert_values) == num_rows_per_multi_insert)
+            serialize_sqlpp();
+    }
+
     if (!multi_insert.values._data._insert_values.empty())
-        db(multi_insert);
+        serialize_sqlpp();
+
+    auto t1 = TimingClock::now();
+
+    auto mysql = mariadb_connect(*config);
+    MultiInsertBuffer raw_insert{mysql.get(), "performance", num_rows_per_multi_insert, 255};
+    char text[256];
+
+    auto t2 = TimingClock::now();
+
+    for (std::int64_t i = 0; i < num_insert_rows; ++i) {
+        const auto len = fmt::format_to_n(text, sizeof(text), "multi insert, row {}/{}", i+1, num_insert_rows).size;
+        raw_insert.add_row(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()), {text, std::min(len, sizeof(text))});
+
+        if (raw_insert.num_rows() == num_rows_per_multi_insert) {
+            num_bytes += raw_insert.statement().size();
+            raw_insert.clear();
+        }
+    }
+
+    if (raw_insert.num_rows() > 0)
+        num_bytes += raw_insert.statement().size();
+
+    auto t3 = TimingClock::now();
 
-    auto t1 = std::chrono::high_resolution_clock::now();
+    const auto sqlpp_ns_per_row = static_cast<double>(elapsed_ns(t0, t1).count()) / static_cast<double>(num_insert_rows);
+    const auto raw_ns_per_row = static_cast<double>(elapsed_ns(t2, t3).count()) / static_cast<double>(num_insert_rows);
 
-    spdlog::get("combined")->info("test multi: {} rows in {}ms (rows per insert: {})", num_insert_rows, std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count(), num_rows_per_multi_insert);
+    spdlog::get("combined")->info("test serialize: sqlpp11 {:.0f}ns/row, raw {:.0f}ns/row, sqlpp11 overhead: {:.2f}x ({} rows, rows per insert: {}, {} bytes)",
+        sqlpp_ns_per_row, raw_ns_per_row, sqlpp_ns_per_row / std::max(raw_ns_per_row, 1.0), num_insert_rows, num_rows_per_multi_insert, num_bytes);
 }
 
-auto eval_args(int argc, char* argv[])
+void test_threaded_inserts(const std::shared_ptr<sqlpp::mysql::connection_config> config, const std::int64_t num_insert_rows, const int num_threads)
 {
-    const auto description = "Run database performance tests.";
-    const auto example = "--rows 1000 --rows_per_multi_insert 100 --config ../mysql.json";
-    int num_insert_rows = 10000;
-    int num_rows_per_multi_insert = 1000;
+    spdlog::info("run test: single inserts with one connection per thread ({} threads)", num_threads);
+
+    // connect up front, a failing connect throws here instead of in a thread the others would wait for
+    std::vector<std::unique_ptr<sqlpp::mysql::connection>> connections;
+
+    for (int t = 0; t < num_threads; ++t)
+        connections.push_back(std::make_unique<sqlpp::mysql::connection>(config));
+
+    std::latch connected{num_threads + 1};
+    std::atomic<int> num_errors{0};
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t] {
+            auto& db = *connections[static_cast<std::size_t>(t)];
+            Performance::Performance performance{};
+
+            connected.arrive_and_wait();
+
+            const std::int64_t begin = num_insert_rows * t / num_threads;
+            const std::int64_t end = num_insert_rows * (t + 1) / num_threads;
+
+            try {
+                for (std::int64_t i = begin; i < end; ++i) {
+                    TraceSpan span{"INSERT (sqlpp11)", "send"};
+                    db(sqlpp::insert_into(performance).set(
+                        performance.time = std::chrono::system_clock::now(),
+                        performance.text = fmt::format("threaded insert, row {}/{}", i+1, num_insert_rows)));
+                }
+            } catch (const std::exception& e) {
+                spdlog::get("combined")->error("test threaded: thread {}: {}", t, e.what());
+                ++num_errors;
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(1s);
+    connected.arrive_and_wait();
+
+    auto t0 = TimingClock::now();
+
+    for (auto& thread : threads)
+        thread.join();
+
+    auto t1 = TimingClock::now();
+
+    spdlog::get("combined")->info("test threaded: {} rows in {:.3f}ms (threads: {}, failed threads: {})", num_insert_rows, elapsed_ms(t0, t1), num_threads, num_errors.load());
+}
+
+void test_async_inserts(const std::shared_ptr<sqlpp::mysql::connection_config> config, const std::int64_t num_insert_rows, const int num_connections)
+{
+    spdlog::info("run test: single inserts on non-blocking connections driven by one thread ({} connections)", num_connections);
+
+    std::vector<MariaDBConnection> connections;
+
+    for (int i = 0; i < num_connections; ++i)
+        connections.push_back(mariadb_connect(*config, 0, true));
+
+    std::this_thread::sleep_for(1s);
+
+    auto t0 = TimingClock::now();
+
+    std::int64_t num_sent_rows = 0;
+
+    const auto results = run_async_inserts(connections, [&](int) -> std::optional<std::string> {
+        if (num_sent_rows == num_insert_rows)
+            return {};
+
+        ++num_sent_rows;
+
+        return fmt::format("INSERT INTO performance (time, text) VALUES ('{:%Y-%m-%d %H:%M:%S}', 'async insert, row {}/{}')",
+            fmt::gmtime(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now())), num_sent_rows, num_insert_rows);
+    });
+
+    auto t1 = TimingClock::now();
+
+    spdlog::get("combined")->info("test async: {} rows in {:.3f}ms (connections: {}, errors: {})", results.num_statements, elapsed_ms(t0, t1), num_connections, results.num_errors);
+}
+
+// Insert rows until the duration has passed and log throughput, statement latencies and table size
+// for every interval, to see how insert speed changes when the table outgrows the buffer pool.
+// The table size is queried on the insert connection between two intervals, so it is not part of their throughput.
+void test_soak(const std::shared_ptr<sqlpp::mysql::connection_config> config, const std::chrono::seconds duration, const int num_rows_per_multi_insert)
+{
+    spdlog::info("run test: soak test, insert multiple rows in one request for {}s", duration.count());
+
+    auto mysql = mariadb_connect(*config);
+    MultiInsertBuffer multi_insert{mysql.get(), "performance", num_rows_per_multi_insert, 255};
+    char text[256];
+
+    // MySQL 8 caches the table statistics in information_schema for a day by default, MariaDB has no such cache
+    if (!mariadb_query_value(mysql.get(), "SHOW SESSION VARIABLES LIKE 'information_schema_stats_expiry'").empty())
+        mariadb_query(mysql.get(), "SET SESSION information_schema_stats_expiry = 0");
+
+    std::int64_t num_rows = 0;
+    std::int64_t num_interval_rows = 0;
+    std::vector<float> latencies;
+
+    std::this_thread::sleep_for(1s);
+
+    const auto t0 = TimingClock::now();
+    auto interval_start = t0;
+
+    while (true) {
+        const auto now = TimingClock::now();
+
+        if (now - interval_start >= 1s) {
+            const auto interval_seconds = std::chrono::duration<double>(now - interval_start).count();
+            const auto size = table_size(mysql.get(), "performance");
+
+            spdlog::get("combined")->info("soak: {}s, {:.0f} rows/s, {} rows, p50: {:.3f}ms, p95: {:.3f}ms, p99: {:.3f}ms, max: {:.3f}ms, table size: {:.1f}MB",
+                std::chrono::duration_cast<std::chrono::seconds>(now - t0).count(), static_cast<double>(num_interval_rows) / interval_seconds, num_rows,
+                percentile(latencies, 50.0f), percentile(latencies, 95.0f), percentile(latencies, 99.0f), percentile(latencies, 100.0f),
+                static_cast<double>(size) / (1024.0 * 1024.0));
+
+            num_interval_rows = 0;
+            latencies.clear();
+            interval_start = TimingClock::now();
+        }
+
+        if (now - t0 >= duration)
+            break;
+
+        {
+            TraceSpan span{"rows", "serialize"};
+
+            for (int i = 0; i < num_rows_per_multi_insert; ++i) {
+                const auto len = fmt::format_to_n(text, sizeof(text), "soak insert, row {}", num_rows + i + 1).size;
+                multi_insert.add_row(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()), {text, std::min(len, sizeof(text))});
+            }
+        }
+
+        const auto q0 = TimingClock::now();
+        mariadb_query(mysql.get(), multi_insert.statement());
+        const auto q1 = TimingClock::now();
+
+        latencies.push_back(static_cast<float>(elapsed_ms(q0, q1)));
+        num_rows += multi_insert.num_rows();
+        num_interval_rows += multi_insert.num_rows();
+        multi_insert.clear();
+    }
+
+    auto t1 = TimingClock::now();
+
+    spdlog::get("combined")->info("test soak: {} rows in {:.3f}ms (rows per insert: {})", num_rows, elapsed_ms(t0, t1), num_rows_per_multi_insert);
+}
+
+// Make sure the table has at least num_rows rows and return the ids of the first num_rows rows.
+// The ids are kept as strings, they are only pasted into statements.
+std::vector<std::string> prepare_rows(MYSQL* mysql, const std::string_view& table_name, const std::int64_t num_rows, const int num_rows_per_multi_insert)
+{
+    const auto num_existing_rows = std::stoll(mariadb_query_value(mysql, fmt::format("SELECT COUNT(*) FROM {}", table_name)));
+
+    if (num_existing_rows < num_rows) {
+        spdlog::info("prepare table \"{}\": insert {} rows", table_name, num_rows - num_existing_rows);
+
+        MultiInsertBuffer multi_insert{mysql, table_name, num_rows_per_multi_insert, 255};
+        char text[256];
+
+        for (std::int64_t i = num_existing_rows; i < num_rows; ++i) {
+            const auto len = fmt::format_to_n(text, sizeof(text), "prepared row {}/{}", i+1, num_rows).size;
+            multi_insert.add_row(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()), {text, std::min(len, sizeof(text))});
+
+            if (multi_insert.num_rows() == num_rows_per_multi_insert) {
+                mariadb_query(mysql, multi_insert.statement());
+                multi_insert.clear();
+            }
+        }
+
+        if (multi_insert.num_rows() > 0)
+            mariadb_query(mysql, multi_insert.statement());
+    }
+
+    return mariadb_query_column(mysql, fmt::format("SELECT id FROM {} ORDER BY id LIMIT {}", table_name, num_rows));
+}
+
+using BuildStatementFunc = std::function<void(std::string& statement, std::span<const std::string> ids, const std::string& time)>;
+
+// Run one statement per batch of existing rows of the performance table, built by build_statement from the ids of the batch.
+void test_batched_mutation(const std::shared_ptr<sqlpp::mysql::connection_config> config, const std::string_view& name, const std::int64_t num_rows, const int batch_size,
+    const BuildStatementFunc& build_statement)
+{
+    spdlog::info("run test: {} existing rows in batches of {} rows", name, batch_size);
+
+    auto mysql = mariadb_connect(*config);
+    const auto ids = prepare_rows(mysql.get(), "performance", num_rows, batch_size);
+    const std::span<const std::string> all_ids{ids};
+    std::string statement;
+    std::int64_t num_affected_rows = 0;
+
+    std::this_thread::sleep_for(1s);
+
+    auto t0 = TimingClock::now();
+
+    for (std::size_t i = 0; i < ids.size(); i += static_cast<std::size_t>(batch_size)) {
+        const auto time = fmt::format("{:%Y-%m-%d %H:%M:%S}", fmt::gmtime(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now())));
+
+        const auto batch_start = TimingClock::now();
+        statement.clear();
+        build_statement(statement, all_ids.subspan(i, std::min(static_cast<std::size_t>(batch_size), ids.size() - i)), time);
+        trace_event(name, "serialize", batch_start, TimingClock::now());
+        mariadb_query(mysql.get(), statement);
+        num_affected_rows += static_cast<std::int64_t>(mysql_affected_rows(mysql.get()));
+    }
+
+    auto t1 = TimingClock::now();
+
+    spdlog::get("combined")->info("test {}: {} rows in {:.3f}ms (rows per statement: {}, affected rows: {})", name, ids.size(), elapsed_ms(t0, t1), batch_size, num_affected_rows);
+}
+
+// Append "(id, 'time', 'text'),..." for every id.
+void append_row_values(std::string& statement, std::span<const std::string> ids, const std::string& time, const std::string_view& text)
+{
+    for (std::size_t i = 0; i < ids.size(); ++i)
+        fmt::format_to(std::back_inserter(statement), "{}({}, '{}', '{}, row {}')", i > 0 ? "," : "", ids[i], time, text, ids[i]);
+}
+
+// MySQL 8.0.20 deprecates VALUES() in ON DUPLICATE KEY UPDATE in favour of a row alias (since 8.0.19),
+// which MariaDB does not support.
+bool supports_insert_row_alias(MYSQL* mysql)
+{
+    return std::string_view{mysql_get_server_info(mysql)}.find("MariaDB") == std::string_view::npos && mysql_get_server_version(mysql) >= 80019;
+}
+
+void test_upserts(const std::shared_ptr<sqlpp::mysql::connection_config> config, const std::int64_t num_rows, const int batch_size)
+{
+    const std::string_view update = supports_insert_row_alias(mariadb_connect(*config).get())
+        ? " AS new ON DUPLICATE KEY UPDATE time = new.time, text = new.text"
+        : " ON DUPLICATE KEY UPDATE time = VALUES(time), text = VALUES(text)";
+
+    test_batched_mutation(config, "upsert", num_rows, batch_size, [update](std::string& statement, std::span<const std::string> ids, const std::string& time) {
+        statement += "INSERT INTO performance (id, time, text) VALUES ";
+        append_row_values(statement, ids, time, "upsert");
+        statement += update;
+    });
+}
+
+void test_replaces(const std::shared_ptr<sqlpp::mysql::connection_config> config, const std::int64_t num_rows, const int batch_size)
+{
+    test_batched_mutation(config, "replace", num_rows, batch_size, [](std::string& statement, std::span<const std::string> ids, const std::string& time) {
+        statement += "REPLACE INTO performance (id, time, text) VALUES ";
+        append_row_values(statement, ids, time, "replace");
+    });
+}
+
+void test_updates(const std::shared_ptr<sqlpp::mysql::connection_config> config, const std::int64_t num_rows, const int batch_size)
+{
+    test_batched_mutation(config, "update", num_rows, batch_size, [](std::string& statement, std::span<const std::string> ids, const std::string& time) {
+        fmt::format_to(std::back_inserter(statement), "UPDATE performance SET time = '{}', text = CONCAT('update, row ', id) WHERE id IN ({})", time, fmt::join(ids, ","));
+    });
+}
+
+void test_deletes(const std::shared_ptr<sqlpp::mysql::connection_config> config, const std::int64_t num_rows, const int batch_size)
+{
+    test_batched_mutation(config, "delete", num_rows, batch_size, [](std::string& statement, std::span<const std::string> ids, const std::string&) {
+        fmt::format_to(std::back_inserter(statement), "DELETE FROM performance WHERE id IN ({})", fmt::join(ids, ","));
+    });
+}
+
+// Compare ways to empty a table: DROP TABLE and CREATE TABLE, TRUNCATE TABLE and DELETE in batches.
+// Runs on its own table "performance_reset", which is filled with num_rows rows before every method.
+void compare_table_resets(sqlpp::mysql::connection& db, const std::shared_ptr<sqlpp::mysql::connection_config> config, const std::int64_t num_rows, const int batch_size)
+{
+    spdlog::info("run test: compare table resets with DROP, TRUNCATE and batched DELETE");
+
+    auto mysql = mariadb_connect(*config);
+
+    const auto refill_table = [&] {
+        create_table(db, "performance_reset");
+        prepare_rows(mysql.get(), "performance_reset", num_rows, batch_size);
+        std::this_thread::sleep_for(1s);
+    };
+
+    drop_table(db, "performance_reset");
+    refill_table();
+
+    // both statements on the same connection, like TRUNCATE and DELETE below
+    const auto create_statement = create_table_statement("performance_reset");
+
+    auto t0 = TimingClock::now();
+    mariadb_query(mysql.get(), "DROP TABLE performance_reset");
+    mariadb_query(mysql.get(), create_statement);
+    auto t1 = TimingClock::now();
+
+    spdlog::get("combined")->info("test reset drop: {} rows in {:.3f}ms", num_rows, elapsed_ms(t0, t1));
+
+    refill_table();
+
+    t0 = TimingClock::now();
+    mariadb_query(mysql.get(), "TRUNCATE TABLE performance_reset");
+    t1 = TimingClock::now();
+
+    spdlog::get("combined")->info("test reset truncate: {} rows in {:.3f}ms", num_rows, elapsed_ms(t0, t1));
+
+    refill_table();
+
+    const auto delete_batch = fmt::format("DELETE FROM performance_reset ORDER BY id LIMIT {}", batch_size);
+
+    t0 = TimingClock::now();
+
+    do {
+        mariadb_query(mysql.get(), delete_batch);
+    } while (mysql_affected_rows(mysql.get()) > 0);
+
+    t1 = TimingClock::now();
+
+    spdlog::get("combined")->info("test reset delete: {} rows in {:.3f}ms (rows per statement: {})", num_rows, elapsed_ms(t0, t1), batch_size);
+
+    drop_table(db, "performance_reset");
+}
+
+struct ContentionOptions {
+    int duration = 10;
+    int hot_rows = 10;
+    int rows_per_transaction = 2;
+    int lock_wait_timeout = 50;
+    std::string isolation_level{"repeatable-read"};
+    bool sorted_locks = false;
+};
+
+// Return the SQL name of an isolation level given like "read-committed" or an empty string for unknown levels.
+std::string isolation_level_sql(const std::string_view& isolation_level)
+{
+    if (isolation_level == "read-uncommitted") return "READ UNCOMMITTED";
+    if (isolation_level == "read-committed") return "READ COMMITTED";
+    if (isolation_level == "repeatable-read") return "REPEATABLE READ";
+    if (isolation_level == "serializable") return "SERIALIZABLE";
+
+    return {};
+}
+
+struct ContentionResults {
+    std::vector<float> latencies;
+    std::int64_t num_commits = 0;
+    std::int64_t num_deadlocks = 0;
+    std::int64_t num_lock_wait_timeouts = 0;
+    std::int64_t num_errors = 0;
+};
+
+// Let num_threads connections update random rows of a small hot set of the performance table in transactions.
+// Deadlocks (the server rolled back the transaction) and lock wait timeouts (only the statement was rolled back)
+// roll back and retry the transaction with the same rows. The latency of a transaction includes all of its retries.
+// With sorted_locks the rows of a transaction are updated in id order, which avoids deadlocks.
+void test_contention(const std::shared_ptr<sqlpp::mysql::connection_config> config, const ContentionOptions& contention, const int num_threads)
+{
+    spdlog::info("run test: {} connections update {} hot rows in transactions for {}s", num_threads, contention.hot_rows, contention.duration);
+
+    const auto isolation_level = isolation_level_sql(contention.isolation_level);
+    std::vector<std::string> hot_ids;
+
+    {
+        auto mysql = mariadb_connect(*config);
+        hot_ids = prepare_rows(mysql.get(), "performance", contention.hot_rows, contention.hot_rows);
+    }
+
+    // connect up front, a failing connect throws here instead of in a thread the others would wait for
+    std::vector<MariaDBConnection> connections;
+
+    for (int t = 0; t < num_threads; ++t) {
+        connections.push_back(mariadb_connect(*config));
+        mariadb_query(connections.back().get(), fmt::format("SET SESSION TRANSACTION ISOLATION LEVEL {}", isolation_level));
+        mariadb_query(connections.back().get(), fmt::format("SET SESSION innodb_lock_wait_timeout = {}", contention.lock_wait_timeout));
+    }
+
+    std::atomic<bool> stop{false};
+    std::vector<ContentionResults> thread_results(static_cast<std::size_t>(num_threads));
+    std::latch ready{num_threads + 1};
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t] {
+            auto& results = thread_results[static_cast<std::size_t>(t)];
+            const auto& mysql = connections[static_cast<std::size_t>(t)];
+
+            std::mt19937_64 rng{static_cast<std::uint64_t>(t)};
+            std::uniform_int_distribution<std::size_t> row_dist{0, hot_ids.size() - 1};
+            std::vector<std::size_t> rows(static_cast<std::size_t>(contention.rows_per_transaction));
+
+            // returns the error number of the statement, 0 on success
+            const auto query = [&](const std::string_view& statement) {
+                TraceSpan span{statement.substr(0, statement.find(' ')), "wait"};
+                return mysql_real_query(mysql.get(), statement.data(), statement.size()) ? mysql_errno(mysql.get()) : 0u;
+            };
+
+            ready.arrive_and_wait();
+
+            while (!stop) {
+                for (auto& row : rows)
+                    row = row_dist(rng);
+
+                if (contention.sorted_locks)
+                    std::sort(rows.begin(), rows.end());
+
+                const auto t0 = TimingClock::now();
+
+                while (!stop) {
+                    unsigned int error = query("START TRANSACTION");
+
+                    for (std::size_t i = 0; i < rows.size() && !error; ++i)
+                        error = query(fmt::format("UPDATE performance SET time = NOW(), text = 'contention, thread {}, update {}' WHERE id = {}", t, i+1, hot_ids[rows[i]]));
+
+                    if (!error)
+                        error = query("COMMIT");
+
+                    // transactions that end after the test time (like a lock wait running into the timeout) are not counted
+                    const bool in_time = !stop;
+
+                    if (!error) {
+                        if (in_time) {
+                            results.latencies.push_back(static_cast<float>(elapsed_ms(t0, TimingClock::now())));
+                            ++results.num_commits;
+                        }
+
+                        break;
+                    }
+
+                    if (!in_time) {
+                        query("ROLLBACK");
+                        break;
+                    }
+
+                    // client errors (like a lost connection) do not go away by retrying, this thread is done
+                    if (error >= CR_MIN_ERROR && error <= CR_MAX_ERROR) {
+                        spdlog::get("combined")->error("test contention: thread {}: {}", t, mysql_error(mysql.get()));
+                        ++results.num_errors;
+                        return;
+                    }
+
+                    if (error == ER_LOCK_DEADLOCK) {
+                        ++results.num_deadlocks;
+                    } else if (error == ER_LOCK_WAIT_TIMEOUT) {
+                        ++results.num_lock_wait_timeouts;
+                    } else {
+                        spdlog::get("combined")->error("test contention: {}", mysql_error(mysql.get()));
+                        ++results.num_errors;
+                    }
+
+                    query("ROLLBACK");
+                }
+            }
+        });
+    }
+
+    ready.arrive_and_wait();
+
+    const auto t0 = TimingClock::now();
+    std::this_thread::sleep_for(std::chrono::seconds{contention.duration});
+
+    // the test ends now, waiting for the threads to finish their transactions is not part of it
+    const auto t1 = TimingClock::now();
+    stop = true;
+
+    for (auto& thread : threads)
+        thread.join();
+
+    ContentionResults results;
+
+    for (const auto& thread_result : thread_results) {
+        results.latencies.insert(results.latencies.end(), thread_result.latencies.begin(), thread_result.latencies.end());
+        results.num_commits += thread_result.num_commits;
+        results.num_deadlocks += thread_result.num_deadlocks;
+        results.num_lock_wait_timeouts += thread_result.num_lock_wait_timeouts;
+        results.num_errors += thread_result.num_errors;
+    }
+
+    spdlog::get("combined")->info("test contention: {} transactions in {:.3f}ms, {:.0f} tx/s, deadlocks: {}, lock wait timeouts: {}, errors: {}, "
+                                  "p50: {:.3f}ms, p95: {:.3f}ms, p99: {:.3f}ms, max: {:.3f}ms "
+                                  "(threads: {}, hot rows: {}, rows per transaction: {}, isolation: {}, sorted locks: {}, lock wait timeout: {}s)",
+        results.num_commits, elapsed_ms(t0, t1), static_cast<double>(results.num_commits) / (elapsed_ms(t0, t1) / 1000.0),
+        results.num_deadlocks, results.num_lock_wait_timeouts, results.num_errors,
+        percentile(results.latencies, 50.0f), percentile(results.latencies, 95.0f), percentile(results.latencies, 99.0f), percentile(results.latencies, 100.0f),
+        num_threads, hot_ids.size(), contention.rows_per_transaction, contention.isolation_level, contention.sorted_locks, contention.lock_wait_timeout);
+}
+
+// Parse a comma-separated list of payload sizes in bytes, like "16,1024,32768".
+std::optional<std::vector<std::size_t>> parse_payload_sizes(const std::string_view& s)
+{
+    std::vector<std::size_t> sizes;
+    const char* p = s.data();
+    const char* const end = s.data() + s.size();
+
+    while (p < end) {
+        std::size_t size = 0;
+        const auto [ptr, ec] = std::from_chars(p, end, size);
+
+        // MEDIUMTEXT holds up to 16MB
+        if (ec != std::errc{} || size < 1 || size > 16 * 1024 * 1024 - 1 || (ptr != end && *ptr != ','))
+            return {};
+
+        sizes.push_back(size);
+        p = ptr + 1;
+    }
+
+    if (sizes.empty())
+        return {};
+
+    return sizes;
+}
+
+struct SessionTraffic {
+    std::int64_t bytes_sent;
+    std::int64_t bytes_received;
+};
+
+// Bytes the server has sent to and received from this connection. The server counts the bytes on the wire,
+// so with CLIENT_COMPRESS these are the compressed sizes. SHOW SESSION STATUS works on MariaDB and MySQL 8,
+// which has no information_schema.SESSION_STATUS anymore.
+SessionTraffic session_traffic(MYSQL* mysql)
+{
+    const auto value = [&](const std::string_view& name) {
+        const auto bytes = mariadb_query_value(mysql, fmt::format("SHOW SESSION STATUS LIKE '{}'", name), 1);
+
+        if (bytes.empty())
+            throw std::runtime_error{fmt::format("session status {} is not available", name)};
+
+        return std::stoll(bytes);
+    };
+
+    return {value("Bytes_sent"), value("Bytes_received")};
+}
+
+// User and system CPU time of the calling thread, which runs the inserts. Without RUSAGE_THREAD (only on Linux)
+// it is the CPU time of the whole process.
+std::chrono::microseconds thread_cpu_time()
+{
+    rusage usage{};
+
+#ifdef RUSAGE_THREAD
+    getrusage(RUSAGE_THREAD, &usage);
+#else
+    getrusage(RUSAGE_SELF, &usage);
+#endif
+
+    return std::chrono::seconds{usage.ru_utime.tv_sec + usage.ru_stime.tv_sec} + std::chrono::microseconds{usage.ru_utime.tv_usec + usage.ru_stime.tv_usec};
+}
+
+// Insert num_insert_rows rows with payload_size bytes of text each into the "performance_payload" table
+// and log throughput, the bytes on the wire in both directions and the client CPU time.
+// The texts are windows into one block of random letters, so generating them costs next to nothing.
+void test_payload_inserts(const std::shared_ptr<sqlpp::mysql::connection_config> config, const std::string_view& name, const std::int64_t num_insert_rows, const int rows_per_insert,
+    const std::string& random_text, const std::size_t payload_size, const bool compress)
+{
+    spdlog::info("run test: {} inserts with {} bytes payload per row (compression: {})", name, payload_size, compress);
+
+    // the sweep switches compression itself, also when --compress is set for all tests
+    auto connection_config = *config;
+    connection_config.client_flag &= ~static_cast<unsigned long>(CLIENT_COMPRESS);
+
+    auto mysql = mariadb_connect(connection_config, compress ? CLIENT_COMPRESS : 0);
+    mariadb_query(mysql.get(), "TRUNCATE TABLE performance_payload");
+
+    MultiInsertBuffer multi_insert{mysql.get(), "performance_payload", rows_per_insert, payload_size};
+    const std::size_t num_text_offsets = random_text.size() - payload_size + 1;
+
+    std::this_thread::sleep_for(1s);
+
+    const auto traffic0 = session_traffic(mysql.get());
+    const auto cpu0 = thread_cpu_time();
+    const auto t0 = TimingClock::now();
+
+    auto batch_start = t0;
+
+    for (std::int64_t i = 0; i < num_insert_rows; ++i) {
+        const auto offset = static_cast<std::size_t>(i * 61) % num_text_offsets;
+        multi_insert.add_row(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()), std::string_view{random_text}.substr(offset, payload_size));
+
+        if (multi_insert.num_rows() == rows_per_insert) {
+            trace_event("rows", "serialize", batch_start, TimingClock::now());
+            mariadb_query(mysql.get(), multi_insert.statement());
+            multi_insert.clear();
+            batch_start = TimingClock::now();
+        }
+    }
+
+    if (multi_insert.num_rows() > 0) {
+        trace_event("rows", "serialize", batch_start, TimingClock::now());
+        mariadb_query(mysql.get(), multi_insert.statement());
+    }
+
+    const auto t1 = TimingClock::now();
+    const auto cpu1 = thread_cpu_time();
+    const auto traffic1 = session_traffic(mysql.get());
+
+    const auto mb = [](const std::int64_t bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); };
+
+    spdlog::get("combined")->info("test payload {}: {} rows in {:.3f}ms (payload: {} bytes, compression: {}, rows per insert: {}, {:.0f} rows/s, "
+                                  "sent: {:.2f}MB, received: {:.2f}MB, client CPU: {:.3f}ms)",
+        name, num_insert_rows, elapsed_ms(t0, t1), payload_size, compress ? "on" : "off", rows_per_insert,
+        static_cast<double>(num_insert_rows) / (elapsed_ms(t0, t1) / 1000.0),
+        mb(traffic1.bytes_received - traffic0.bytes_received), mb(traffic1.bytes_sent - traffic0.bytes_sent),
+        std::chrono::duration<double, std::milli>(cpu1 - cpu0).count());
+}
+
+// Run single and multi inserts for every payload size, without and with protocol compression (CLIENT_COMPRESS).
+// Multi inserts are limited to about 4MB per statement (or half of max_allowed_packet, if smaller), payload
+// sizes whose single-row insert does not fit into max_allowed_packet are skipped.
+void test_payload_sizes(sqlpp::mysql::connection& db, const std::shared_ptr<sqlpp::mysql::connection_config> config, const std::vector<std::size_t>& payload_sizes,
+    const std::int64_t num_insert_rows, const int num_rows_per_multi_insert)
+{
+    drop_table(db, "performance_payload");
+
+    db.execute(
+        "CREATE TABLE performance_payload ("
+        "    id     BIGINT NOT NULL AUTO_INCREMENT,"
+        "    time   DATETIME NOT NULL,"
+        "    text   MEDIUMTEXT NOT NULL,"
+        "    PRIMARY KEY (id)"
+        ") CHARSET=utf8 COLLATE=utf8_unicode_ci");
+
+    auto mysql = mariadb_connect(*config);
+
+    // fail once here instead of in every run below, if the server does not report the session traffic
+    session_traffic(mysql.get());
+
+    const auto max_allowed_packet = static_cast<std::size_t>(std::stoull(mariadb_query_value(mysql.get(), "SELECT @@max_allowed_packet")));
+    const std::size_t max_statement_size = std::min<std::size_t>(4 * 1024 * 1024, max_allowed_packet / 2);
+
+    std::mt19937_64 rng{0};
+    std::uniform_int_distribution<int> char_dist{'a', 'z'};
+
+    for (const auto payload_size : payload_sizes) {
+        // statement overhead of a single-row insert, the payload are letters and needs no escaping
+        if (payload_size + 1024 > max_allowed_packet) {
+            spdlog::get("combined")->error("test payload: skipping {} bytes payload, a single-row insert does not fit into max_allowed_packet ({} bytes)", payload_size, max_allowed_packet);
+            continue;
+        }
+
+        std::string random_text(payload_size + 4096, ' ');
+
+        for (auto& c : random_text)
+            c = static_cast<char>(char_dist(rng));
+
+        const int rows_per_insert = static_cast<int>(std::clamp<std::size_t>(max_statement_size / (payload_size + 32), 1, static_cast<std::size_t>(num_rows_per_multi_insert)));
+
+        for (const bool compress : {false, true}) {
+            try {
+                test_payload_inserts(config, "single", num_insert_rows, 1, random_text, payload_size, compress);
+                test_payload_inserts(config, "multi", num_insert_rows, rows_per_insert, random_text, payload_size, compress);
+            } catch (const std::exception& e) {
+                spdlog::get("combined")->error("test payload {} bytes (compression: {}): {}", payload_size, compress ? "on" : "off", e.what());
+            }
+        }
+    }
+
+    drop_table(db, "performance_payload");
+}
+
+struct Options {
     bool run_single = false;
     bool run_multi = false;
+    bool run_raw = false;
+    bool run_serialize = false;
+    bool run_threaded = false;
+    bool run_async = false;
+    bool run_multi_statement = false;
+    bool run_soak = false;
+    bool run_generic = false;
+    bool run_upsert = false;
+    bool run_replace = false;
+    bool run_update = false;
+    bool run_delete = false;
+    bool run_reset = false;
+    bool run_contention = false;
+    bool run_payload = false;
+    bool keep_table = false;
+    bool compress = false;
+    std::optional<SeedTarget> seed_target;
+    std::string db_config_filename{"mysql.json"};
+    std::string logfile_name{"logs/db_insert.log"};
+    std::string trace_filename;
+    std::int64_t num_insert_rows = 10000;
+    int num_rows_per_multi_insert = 1000;
+    int num_threads = 8;
+    int num_connections = 8;
+    int num_statements_per_request = 1000;
+    int soak_duration = 3600;
+    int batch_size = 1000;
+    RowGeneratorConfig row_generator;
+    ContentionOptions contention;
+    std::vector<std::size_t> payload_sizes;
+};
+
+Options eval_args(int argc, char* argv[])
+{
+    const auto description = "Run database performance tests.";
+    const auto example = "--rows 1000 --rows_per_multi_insert 100 --config ../mysql.json";
+    Options opts;
     bool run_all = true;
     bool show_help = false;
     auto log_level = spdlog::level::warn;
-    std::string db_config_filename{"mysql.json"};
-    std::string logfile_name{"logs/db_insert.log"};
+    std::string seed_target;
+    std::string payload_sizes;
 
     auto cli = (
-        (clipp::option("--single").set(run_single).set(run_all, false)
+        (clipp::option("--single").set(opts.run_single).set(run_all, false)
             % "run test: single inserts for every row",
-         clipp::option("--multi").set(run_multi).set(run_all, false)
-            % "run test: insert multiple rows in one request") |
+         clipp::option("--multi").set(opts.run_multi).set(run_all, false)
+            % "run test: insert multiple rows in one request",
+         clipp::option("--raw").set(opts.run_raw).set(run_all, false)
+            % "run test: insert multiple rows in one request without query builder",
+         clipp::option("--serialize").set(opts.run_serialize).set(run_all, false)
+            % "run test: client-side cost per row of building multi inserts (sqlpp11 vs. raw)",
+         clipp::option("--generic").set(opts.run_generic).set(run_all, false)
+            % "run test: insert multiple generated rows in one request through the generic table benchmark",
+         clipp::option("--threaded").set(opts.run_threaded).set(run_all, false)
+            % "run test: single inserts with one blocking connection per thread",
+         clipp::option("--async").set(opts.run_async).set(run_all, false)
+            % "run test: single inserts on non-blocking connections driven by one thread",
+         clipp::option("--upsert").set(opts.run_upsert).set(run_all, false)
+            % "run test: INSERT ... ON DUPLICATE KEY UPDATE of existing rows in batches",
+         clipp::option("--replace").set(opts.run_replace).set(run_all, false)
+            % "run test: REPLACE of existing rows in batches",
+         clipp::option("--update").set(opts.run_update).set(run_all, false)
+            % "run test: UPDATE ... WHERE id IN (...) of existing rows in batches",
+         clipp::option("--delete").set(opts.run_delete).set(run_all, false)
+            % "run test: DELETE ... WHERE id IN (...) of existing rows in batches",
+         clipp::option("--reset").set(opts.run_reset).set(run_all, false)
+            % "run test: compare DROP TABLE, TRUNCATE TABLE and batched DELETE to empty a table",
+         (clipp::option("--multi-statement").set(opts.run_multi_statement).set(run_all, false) & clipp::integer("num_statements_per_request", opts.num_statements_per_request))
+            % fmt::format("run test: multiple single-row inserts in one request and compare with --multi at the same batch size (default: {})", opts.num_statements_per_request),
+         (clipp::option("--duration").set(opts.run_soak).set(run_all, false) & clipp::integer("seconds", opts.soak_duration))
+            % fmt::format("run test: soak test, multi inserts for \"seconds\" and log throughput every second (default: {}s)", opts.soak_duration),
+         (clipp::option("--contention").set(opts.run_contention).set(run_all, false) & clipp::integer("seconds", opts.contention.duration))
+            % fmt::format("run test: update a hot set of rows in transactions from --threads connections for \"seconds\" (default: {}s)", opts.contention.duration),
+         (clipp::option("--payload").set(opts.run_payload).set(run_all, false) & clipp::value("sizes", payload_sizes))
+            % "run test: single and multi inserts with comma-separated text payload sizes in bytes (like 16,1024,32768), with and without protocol compression") |
         clipp::option("--all").set(run_all)
-            % "run all tests (default)",
-        (clipp::option("--config") & clipp::value("filename", db_config_filename))
-            % fmt::format("database connection config (default: {})", db_config_filename),
-        (clipp::option("--rows") & clipp::value("num_insert_rows", num_insert_rows))
-            % fmt::format("number of insert rows (default: {})", num_insert_rows),
-        (clipp::option("--rows_per_multi_insert") & clipp::value("num_rows_per_multi_insert", num_rows_per_multi_insert))
-            % fmt::format("number of rows per multi insert (default: {})", num_rows_per_multi_insert),
-        (clipp::option("--log") & clipp::value("logfile", logfile_name))
-            % fmt::format("logfile name (default: {})", logfile_name),
+            % "run all tests except the soak, contention and payload tests (default)",
+        (clipp::option("--seed").set(run_all, false) & clipp::value("rows|size", seed_target))
+            % "seed the table with a number of rows or to a size (like 500MB or 100GB) before running tests",
+        clipp::option("--keep-table").set(opts.keep_table)
+            % "do not drop and recreate the table",
+        clipp::option("--compress").set(opts.compress)
+            % "use protocol compression (CLIENT_COMPRESS) for all connections",
+        (clipp::option("--config") & clipp::value("filename", opts.db_config_filename))
+            % fmt::format("database connection config (default: {})", opts.db_config_filename),
+        (clipp::option("--rows") & clipp::value("num_insert_rows", opts.num_insert_rows))
+            % fmt::format("number of insert rows (default: {})", opts.num_insert_rows),
+        (clipp::option("--rows_per_multi_insert") & clipp::value("num_rows_per_multi_insert", opts.num_rows_per_multi_insert))
+            % fmt::format("number of rows per multi insert (default: {})", opts.num_rows_per_multi_insert),
+        (clipp::option("--batch-size") & clipp::integer("rows", opts.batch_size))
+            % fmt::format("number of rows per statement for the upsert, replace, update, delete and reset tests (default: {})", opts.batch_size),
+        (clipp::option("--hot-rows") & clipp::integer("rows", opts.contention.hot_rows))
+            % fmt::format("number of hot rows for the contention test (default: {})", opts.contention.hot_rows),
+        (clipp::option("--tx-rows") & clipp::integer("rows", opts.contention.rows_per_transaction))
+            % fmt::format("number of rows updated per transaction in the contention test (default: {})", opts.contention.rows_per_transaction),
+        (clipp::option("--isolation") & clipp::value("level", opts.contention.isolation_level))
+            % fmt::format("transaction isolation level for the contention test: read-uncommitted, read-committed, repeatable-read or serializable (default: {})", opts.contention.isolation_level),
+        clipp::option("--sorted-locks").set(opts.contention.sorted_locks)
+            % "update the rows of a transaction in id order in the contention test",
+        (clipp::option("--lock-wait-timeout") & clipp::integer("seconds", opts.contention.lock_wait_timeout))
+            % fmt::format("innodb_lock_wait_timeout for the contention test (default: {}s)", opts.contention.lock_wait_timeout),
+        (clipp::option("--varchar-length") & clipp::value("length", opts.row_generator.varchar_length))
+            % fmt::format("length of generated varchar values for the generic test, at most the column length (default: {})", opts.row_generator.varchar_length),
+        (clipp::option("--blob-length") & clipp::value("length", opts.row_generator.blob_length))
+            % fmt::format("length of generated BLOB values for the generic test, at most the column length (default: {})", opts.row_generator.blob_length),
+        (clipp::option("--threads") & clipp::integer("num_threads", opts.num_threads))
+            % fmt::format("number of threads for the threaded and contention tests and for seeding (default: {})", opts.num_threads),
+        (clipp::option("--connections") & clipp::integer("num_connections", opts.num_connections))
+            % fmt::format("number of connections for the async test (default: {})", opts.num_connections),
+        (clipp::option("--log") & clipp::value("logfile", opts.logfile_name))
+            % fmt::format("logfile name (default: {})", opts.logfile_name),
+        (clipp::option("--trace") & clipp::value("tracefile", opts.trace_filename))
+            % "write a trace file in Chrome trace-event format (open it in Perfetto)",
         clipp::option("-h", "--help").set(show_help)
             % "show help",
         clipp::option("-v", "--verbose").set(log_level, spdlog::level::info)
@@ -172,39 +1221,171 @@ auto eval_args(int argc, char* argv[])
         show_usage_and_exit(cli, argv[0], description, example);
 
     spdlog::set_level(log_level);
-    spdlog::info("command line option --single: {}", run_single);
-    spdlog::info("command line option --multi: {}", run_multi);
+    spdlog::info("command line option --single: {}", opts.run_single);
+    spdlog::info("command line option --multi: {}", opts.run_multi);
+    spdlog::info("command line option --raw: {}", opts.run_raw);
+    spdlog::info("command line option --serialize: {}", opts.run_serialize);
+    spdlog::info("command line option --generic: {}", opts.run_generic);
+    spdlog::info("command line option --threaded: {}", opts.run_threaded);
+    spdlog::info("command line option --async: {}", opts.run_async);
+    spdlog::info("command line option --upsert: {}", opts.run_upsert);
+    spdlog::info("command line option --replace: {}", opts.run_replace);
+    spdlog::info("command line option --update: {}", opts.run_update);
+    spdlog::info("command line option --delete: {}", opts.run_delete);
+    spdlog::info("command line option --reset: {}", opts.run_reset);
+    spdlog::info("command line option --multi-statement: {} ({})", opts.run_multi_statement, opts.num_statements_per_request);
+    spdlog::info("command line option --duration: {} ({}s)", opts.run_soak, opts.soak_duration);
+    spdlog::info("command line option --contention: {} ({}s)", opts.run_contention, opts.contention.duration);
+    spdlog::info("command line option --payload: {} ({})", opts.run_payload, payload_sizes);
     spdlog::info("command line option --all: {}", run_all);
-    spdlog::info("command line option --config: {}", db_config_filename);
-    spdlog::info("command line option --rows: {}", num_insert_rows);
-    spdlog::info("command line option --rows_per_multi_insert: {}", num_rows_per_multi_insert);
-    spdlog::info("command line option --log: {}", logfile_name);
+    spdlog::info("command line option --seed: {}", seed_target);
+    spdlog::info("command line option --keep-table: {}", opts.keep_table);
+    spdlog::info("command line option --compress: {}", opts.compress);
+    spdlog::info("command line option --config: {}", opts.db_config_filename);
+    spdlog::info("command line option --rows: {}", opts.num_insert_rows);
+    spdlog::info("command line option --rows_per_multi_insert: {}", opts.num_rows_per_multi_insert);
+    spdlog::info("command line option --batch-size: {}", opts.batch_size);
+    spdlog::info("command line option --hot-rows: {}", opts.contention.hot_rows);
+    spdlog::info("command line option --tx-rows: {}", opts.contention.rows_per_transaction);
+    spdlog::info("command line option --isolation: {}", opts.contention.isolation_level);
+    spdlog::info("command line option --sorted-locks: {}", opts.contention.sorted_locks);
+    spdlog::info("command line option --lock-wait-timeout: {}s", opts.contention.lock_wait_timeout);
+    spdlog::info("command line option --varchar-length: {}", opts.row_generator.varchar_length);
+    spdlog::info("command line option --blob-length: {}", opts.row_generator.blob_length);
+    spdlog::info("command line option --threads: {}", opts.num_threads);
+    spdlog::info("command line option --connections: {}", opts.num_connections);
+    spdlog::info("command line option --log: {}", opts.logfile_name);
+    spdlog::info("command line option --trace: {}", opts.trace_filename);
 
     if (run_all) {
-        run_single = true;
-        run_multi = true;
+        opts.run_single = true;
+        opts.run_multi = true;
+        opts.run_raw = true;
+        opts.run_serialize = true;
+        opts.run_generic = true;
+        opts.run_threaded = true;
+        opts.run_async = true;
+        opts.run_multi_statement = true;
+        opts.run_upsert = true;
+        opts.run_replace = true;
+        opts.run_update = true;
+        opts.run_delete = true;
+        opts.run_reset = true;
+    }
+
+    if (opts.run_payload) {
+        const auto sizes = parse_payload_sizes(payload_sizes);
+
+        if (!sizes.has_value())
+            show_usage_and_exit(cli, argv[0], description, example);
+
+        opts.payload_sizes = *sizes;
     }
 
-    if (show_help || !(run_single || run_multi))
+    if (!seed_target.empty()) {
+        opts.seed_target = parse_seed_target(seed_target);
+
+        if (!opts.seed_target.has_value())
+            show_usage_and_exit(cli, argv[0], description, example);
+    }
+
+    const bool any_test = opts.run_single || opts.run_multi || opts.run_raw || opts.run_serialize || opts.run_generic || opts.run_threaded || opts.run_async || opts.run_multi_statement || opts.run_soak
+        || opts.run_upsert || opts.run_replace || opts.run_update || opts.run_delete || opts.run_reset || opts.run_contention || opts.run_payload;
+
+    if (show_help || !(any_test || opts.seed_target.has_value()) || opts.num_insert_rows < 1 || opts.num_rows_per_multi_insert < 1 || opts.num_threads < 1 || opts.num_connections < 1 || opts.num_statements_per_request < 1 || opts.soak_duration < 1 || opts.batch_size < 1
+        || opts.contention.duration < 1 || opts.contention.hot_rows < 1 || opts.contention.rows_per_transaction < 1 || opts.contention.lock_wait_timeout < 1
+        || isolation_level_sql(opts.contention.isolation_level).empty())
         show_usage_and_exit(cli, argv[0], description, example);
 
-    return std::make_tuple(run_single, run_multi, db_config_filename, num_insert_rows, num_rows_per_multi_insert, logfile_name);
+    return opts;
+}
+
+void run_tests(sqlpp::mysql::connection& db, const std::shared_ptr<sqlpp::mysql::connection_config> config, const Options& opts)
+{
+    if (!opts.keep_table)
+        drop_table(db, "performance");
+
+    create_table(db, "performance");
+
+    if (opts.seed_target.has_value())
+        seed_table(config, *opts.seed_target, opts.num_threads, opts.num_rows_per_multi_insert);
+
+    if (opts.run_single)
+        test_single_inserts(db, opts.num_insert_rows);
+
+    std::optional<std::chrono::nanoseconds> multi_ns;
+
+    if (opts.run_multi)
+        multi_ns = test_multiple_inserts(db, opts.num_insert_rows, opts.num_rows_per_multi_insert);
+
+    if (opts.run_raw)
+        test_raw_multiple_inserts(config, opts.num_insert_rows, opts.num_rows_per_multi_insert);
+
+    if (opts.run_serialize)
+        test_serialization(db, config, opts.num_insert_rows, opts.num_rows_per_multi_insert);
+
+    // add sqlpp11-ddl2cpp generated tables here to benchmark them, like:
+    // test_generic_inserts<Wide::Wide>(db, opts.num_insert_rows, opts.num_rows_per_multi_insert, opts.row_generator);
+    if (opts.run_generic)
+        test_generic_inserts<Performance::Performance>(db, opts.num_insert_rows, opts.num_rows_per_multi_insert, opts.row_generator);
+
+    if (opts.run_threaded)
+        test_threaded_inserts(config, opts.num_insert_rows, opts.num_threads);
+
+    if (opts.run_async)
+        test_async_inserts(config, opts.num_insert_rows, opts.num_connections);
+
+    if (opts.run_multi_statement)
+        compare_multi_statement_with_multiple_inserts(db, config, opts.num_insert_rows, opts.num_statements_per_request,
+            opts.num_statements_per_request == opts.num_rows_per_multi_insert ? multi_ns : std::nullopt);
+
+    if (opts.run_upsert)
+        test_upserts(config, opts.num_insert_rows, opts.batch_size);
+
+    if (opts.run_replace)
+        test_replaces(config, opts.num_insert_rows, opts.batch_size);
+
+    if (opts.run_update)
+        test_updates(config, opts.num_insert_rows, opts.batch_size);
+
+    if (opts.run_delete)
+        test_deletes(config, opts.num_insert_rows, opts.batch_size);
+
+    if (opts.run_reset)
+        compare_table_resets(db, config, opts.num_insert_rows, opts.batch_size);
+
+    if (opts.run_soak)
+        test_soak(config, std::chrono::seconds{opts.soak_duration}, opts.num_rows_per_multi_insert);
+
+    if (opts.run_contention)
+        test_contention(config, opts.contention, opts.num_threads);
+
+    if (opts.run_payload)
+        test_payload_sizes(db, config, opts.payload_sizes, opts.num_insert_rows, opts.num_rows_per_multi_insert);
 }
 
 int main(int argc, char* argv[])
 {
-    auto [run_single, run_multi, db_config_filename, num_insert_rows, num_rows_per_multi_insert, logfile_name] = eval_args(argc, argv);
-    auto config = read_mysql_config(db_config_filename);
+    const auto opts = eval_args(argc, argv);
+    auto config = read_mysql_config(opts.db_config_filename);
+
+    if (opts.compress)
+        config->client_flag |= CLIENT_COMPRESS;
+
     auto db = connect_database(config);
 
-    create_combined_logger(logfile_name);
+    create_combined_logger(opts.logfile_name);
 
-    drop_table(db, "performance");
-    create_table(db, "performance");
+    if (!opts.trace_filename.empty())
+        start_trace(opts.trace_filename);
 
-    if (run_single)
-        test_single_inserts(db, num_insert_rows);
+    // write the trace of a failed run as well, it shows what happened until the error
+    try {
+        run_tests(db, config, opts);
+    } catch (...) {
+        finish_trace();
+        throw;
+    }
 
-    if (run_single)
-        test_multiple_inserts(db, num_insert_rows, num_rows_per_multi_insert);
+    finish_trace();
 }
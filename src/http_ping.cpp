@@ -2,19 +2,24 @@
 #include <csignal>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <tuple>
 #include <vector>
 
 #include <clipp.h>
 #include <cpr/cpr.h>
+#include <curl/curl.h>
 #include <fmt/core.h>
 #include <fmt/ostream.h>
 #include <nlohmann/json.hpp>
 #include <spdlog/spdlog.h>
 
 #include "common/combined_logger.h"
+#include "common/metrics.h"
 #include "common/statistics.h"
+#include "common/timing.h"
+#include "common/trace.h"
 #include "common/usage.h"
 
 using namespace std::chrono_literals;
@@ -31,7 +36,22 @@ void signal_handler(int signal)
 
 std::optional<float> ping(const std::string& url, std::chrono::milliseconds timeout)
 {
-    const auto r = cpr::Get(cpr::Url{url}, cpr::Timeout{timeout});
+    cpr::Session sess;
+    sess.SetUrl(url);
+    sess.SetTimeout(timeout);
+
+    const auto send_time = TimingClock::now();
+    const auto r = sess.Get();
+
+    if (trace_enabled()) {
+        curl_off_t pretransfer_time_us = 0;
+        curl_off_t total_time_us = 0;
+
+        curl_easy_getinfo(sess.GetCurlHolder()->handle, CURLINFO_PRETRANSFER_TIME_T, &pretransfer_time_us);
+        curl_easy_getinfo(sess.GetCurlHolder()->handle, CURLINFO_TOTAL_TIME_T, &total_time_us);
+
+        trace_http_request("GET", send_time, std::chrono::microseconds{pretransfer_time_us}, std::chrono::microseconds{total_time_us});
+    }
 
     if (r.status_code == 200)
         return {1000.0f * static_cast<float>(r.elapsed)};
@@ -44,7 +64,7 @@ std::optional<float> ping(const std::string& url, std::chrono::milliseconds time
     return {};
 }
 
-auto continuously_send_pings(const std::string& url, std::chrono::seconds interval, std::chrono::milliseconds timeout)
+auto continuously_send_pings(const std::string& url, std::chrono::seconds interval, std::chrono::milliseconds timeout, Metrics& metrics)
 {
     spdlog::info("pinging {}...", url);
 
@@ -55,10 +75,12 @@ auto continuously_send_pings(const std::string& url, std::chrono::seconds interv
         auto ms = ping(url, timeout);
 
         if (ms.has_value()) {
-            spdlog::get("combined")->info("{} --> {:.0f}ms", url, ms.value());
+            spdlog::get("combined")->info("{} --> {:.3f}ms", url, ms.value());
             durations.push_back(ms.value());
+            record_success(metrics, ms.value());
         } else {
             ++num_errors;
+            record_error(metrics);
         }
 
         std::this_thread::sleep_for(interval);
@@ -67,6 +89,189 @@ auto continuously_send_pings(const std::string& url, std::chrono::seconds interv
     return std::make_tuple(durations, num_errors);
 }
 
+struct ThroughputConfig {
+    long http_version;
+    const char* accept_encoding;  // nullptr: do not send Accept-Encoding
+};
+
+struct Transfer {
+    CURL* easy = nullptr;  // while the transfer is running
+    int index = 0;
+    TimingClock::time_point start;
+    std::size_t decoded_bytes = 0;
+};
+
+std::size_t count_decoded_bytes(char*, std::size_t size, std::size_t nmemb, void* userdata)
+{
+    static_cast<Transfer*>(userdata)->decoded_bytes += size * nmemb;
+    return size * nmemb;
+}
+
+std::string_view http_version_name(const long http_version)
+{
+    switch (http_version) {
+        case CURL_HTTP_VERSION_1_0: return "HTTP/1.0";
+        case CURL_HTTP_VERSION_1_1: return "HTTP/1.1";
+        case CURL_HTTP_VERSION_2_0: return "HTTP/2";
+        case CURL_HTTP_VERSION_2TLS: return "HTTP/2";
+        default: return "HTTP/?";
+    }
+}
+
+// Download the URL num_requests times with up to num_parallel concurrent transfers and report bytes on the wire,
+// decoded bytes and throughput. With HTTP/2 all transfers are multiplexed over one connection, with HTTP/1.1
+// every concurrent transfer needs its own connection.
+void measure_throughput(const std::string& url, std::chrono::milliseconds timeout, const int num_requests, const int num_parallel, const ThroughputConfig& config)
+{
+    const bool http2 = config.http_version == CURL_HTTP_VERSION_2TLS;
+    const std::string name = fmt::format("{}, {}", http_version_name(config.http_version), config.accept_encoding ? config.accept_encoding : "no compression");
+
+    spdlog::info("measuring throughput of {} [{}]...", url, name);
+
+    CURLM* multi = curl_multi_init();
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, http2 ? CURLPIPE_MULTIPLEX : CURLPIPE_NOTHING);
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, http2 ? 1L : static_cast<long>(num_parallel));
+
+    std::vector<Transfer> transfers(static_cast<std::size_t>(num_requests));
+    std::vector<float> durations;
+    curl_off_t wire_bytes = 0;
+    std::size_t decoded_bytes = 0;
+    long negotiated_http_version = 0;
+    int num_errors = 0;
+    int num_started = 0;
+    int num_running = 0;
+
+    const auto start_transfer = [&] {
+        CURL* easy = curl_easy_init();
+        Transfer* transfer = &transfers[static_cast<std::size_t>(num_started)];
+        transfer->index = num_started++;
+        transfer->start = TimingClock::now();
+        transfer->easy = easy;
+
+        curl_easy_setopt(easy, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, static_cast<long>(timeout.count()));
+        curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, config.http_version);
+        curl_easy_setopt(easy, CURLOPT_PIPEWAIT, http2 ? 1L : 0L);
+        curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, count_decoded_bytes);
+        curl_easy_setopt(easy, CURLOPT_WRITEDATA, transfer);
+        curl_easy_setopt(easy, CURLOPT_PRIVATE, transfer);
+
+        if (config.accept_encoding)
+            curl_easy_setopt(easy, CURLOPT_ACCEPT_ENCODING, config.accept_encoding);
+
+        curl_multi_add_handle(multi, easy);
+        ++num_running;
+    };
+
+    const auto t0 = TimingClock::now();
+
+    while (num_started < num_requests && num_running < num_parallel)
+        start_transfer();
+
+    while (num_running > 0 && running) {
+        int still_running = 0;
+        curl_multi_perform(multi, &still_running);
+
+        int num_msgs = 0;
+
+        while (CURLMsg* msg = curl_multi_info_read(multi, &num_msgs)) {
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+
+            CURL* easy = msg->easy_handle;
+            Transfer* transfer = nullptr;
+            long status_code = 0;
+            curl_off_t size_download = 0;
+            curl_off_t pretransfer_time_us = 0;
+            curl_off_t total_time_us = 0;
+
+            curl_easy_getinfo(easy, CURLINFO_PRIVATE, &transfer);
+            curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &status_code);
+            curl_easy_getinfo(easy, CURLINFO_SIZE_DOWNLOAD_T, &size_download);
+            curl_easy_getinfo(easy, CURLINFO_PRETRANSFER_TIME_T, &pretransfer_time_us);
+            curl_easy_getinfo(easy, CURLINFO_TOTAL_TIME_T, &total_time_us);
+            curl_easy_getinfo(easy, CURLINFO_HTTP_VERSION, &negotiated_http_version);
+
+            // transfers overlap on this thread, so every transfer gets its own track
+            trace_http_request("GET", transfer->start, std::chrono::microseconds{pretransfer_time_us}, std::chrono::microseconds{total_time_us}, transfer->index);
+
+            if (msg->data.result == CURLE_OK && status_code == 200) {
+                durations.push_back(static_cast<float>(total_time_us) / 1000.0f);
+                wire_bytes += size_download;
+                decoded_bytes += transfer->decoded_bytes;
+            } else {
+                if (msg->data.result != CURLE_OK)
+                    spdlog::get("combined")->error(curl_easy_strerror(msg->data.result));
+                else
+                    spdlog::get("combined")->warn("HTTP status {}", status_code);
+
+                ++num_errors;
+            }
+
+            curl_multi_remove_handle(multi, easy);
+            curl_easy_cleanup(easy);
+            transfer->easy = nullptr;
+            --num_running;
+
+            if (num_started < num_requests)
+                start_transfer();
+        }
+
+        if (num_running > 0)
+            curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+    }
+
+    const auto t1 = TimingClock::now();
+
+    // transfers still running when the measurement was interrupted
+    for (auto& transfer : transfers) {
+        if (transfer.easy) {
+            curl_multi_remove_handle(multi, transfer.easy);
+            curl_easy_cleanup(transfer.easy);
+            transfer.easy = nullptr;
+        }
+    }
+
+    curl_multi_cleanup(multi);
+
+    const auto seconds = elapsed_ms(t0, t1) / 1000.0;
+    const auto mb = [](const double bytes) { return bytes / (1024.0 * 1024.0); };
+
+    spdlog::get("combined")->info("{} [{}] --> successful: {}, errors: {}, {:.3f}ms, wire: {} bytes, decoded: {} bytes ({:.1f}%), "
+                                  "wire: {:.2f}MB/s, decoded: {:.2f}MB/s, mean: {:.3f}ms, median: {:.3f}ms (negotiated: {}, parallel: {})",
+        url, name, durations.size(), num_errors, elapsed_ms(t0, t1), wire_bytes, decoded_bytes,
+        decoded_bytes > 0 ? 100.0 * static_cast<double>(wire_bytes) / static_cast<double>(decoded_bytes) : 100.0,
+        mb(static_cast<double>(wire_bytes)) / seconds, mb(static_cast<double>(decoded_bytes)) / seconds,
+        mean(durations), median(durations), http_version_name(negotiated_http_version), num_parallel);
+}
+
+// Compare every combination of HTTP/1.1 and HTTP/2 with and without gzip and Brotli compression.
+void measure_throughput_configs(const std::string& url, std::chrono::milliseconds timeout, const int num_requests, const int num_parallel)
+{
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    const auto* curl_info = curl_version_info(CURLVERSION_NOW);
+
+    for (const long http_version : {static_cast<long>(CURL_HTTP_VERSION_1_1), static_cast<long>(CURL_HTTP_VERSION_2TLS)}) {
+        if (http_version == CURL_HTTP_VERSION_2TLS && !(curl_info->features & CURL_VERSION_HTTP2)) {
+            spdlog::get("combined")->warn("libcurl has no HTTP/2 support, skipping HTTP/2");
+            continue;
+        }
+
+        for (const char* accept_encoding : {static_cast<const char*>(nullptr), "gzip", "br"}) {
+            if (accept_encoding && std::string_view{accept_encoding} == "br" && !(curl_info->features & CURL_VERSION_BROTLI)) {
+                spdlog::get("combined")->warn("libcurl has no Brotli support, skipping br");
+                continue;
+            }
+
+            if (running)
+                measure_throughput(url, timeout, num_requests, num_parallel, ThroughputConfig{http_version, accept_encoding});
+        }
+    }
+
+    curl_global_cleanup();
+}
+
 auto eval_args(int argc, char* argv[])
 {
     const auto description = "Ping a URL.";
@@ -75,8 +280,13 @@ auto eval_args(int argc, char* argv[])
     auto log_level = spdlog::level::warn;
     int interval = 1;
     int timeout = 30000;
+    int metrics_port = 0;
+    int num_requests = 10;
+    int num_parallel = 4;
+    bool run_throughput = false;
     std::string url;
     std::string logfile_name{"logs/http_ping.log"};
+    std::string trace_filename;
 
     auto cli = (
         clipp::option("-h", "--help").set(show_help)
@@ -87,10 +297,20 @@ auto eval_args(int argc, char* argv[])
             % "URL to ping",
         (clipp::option("--log") & clipp::value("logfile", logfile_name))
             % fmt::format("logfile name (default: {})", logfile_name),
+        (clipp::option("--trace") & clipp::value("tracefile", trace_filename))
+            % "write a trace file in Chrome trace-event format (open it in Perfetto)",
         (clipp::option("--interval") & clipp::integer("interval", interval))
             % fmt::format("wait \"interval\" seconds between each request (default: {}s)", interval),
         (clipp::option("--timeout") & clipp::integer("timeout", timeout))
-            % fmt::format("request timeout in milliseconds (default: {}ms)", timeout)
+            % fmt::format("request timeout in milliseconds (default: {}ms)", timeout),
+        clipp::option("--throughput").set(run_throughput)
+            % "measure bytes and throughput with and without compression over HTTP/1.1 and HTTP/2 instead of pinging",
+        (clipp::option("--requests") & clipp::integer("requests", num_requests))
+            % fmt::format("number of requests per throughput configuration (default: {})", num_requests),
+        (clipp::option("--parallel") & clipp::integer("parallel", num_parallel))
+            % fmt::format("number of concurrent requests for throughput measurements (default: {})", num_parallel),
+        (clipp::option("--metrics-port") & clipp::integer("port", metrics_port))
+            % "serve live metrics in Prometheus format on http://127.0.0.1:<port>/metrics (default: off)"
     );
 
     if (!clipp::parse(argc, argv, cli))
@@ -99,23 +319,45 @@ auto eval_args(int argc, char* argv[])
     spdlog::set_level(log_level);
     spdlog::info("command line option \"url\": {}", url);
     spdlog::info("command line option --log: {}", logfile_name);
+    spdlog::info("command line option --trace: {}", trace_filename);
     spdlog::info("command line option --interval: {}s", interval);
     spdlog::info("command line option --timeout: {}ms", timeout);
+    spdlog::info("command line option --throughput: {}", run_throughput);
+    spdlog::info("command line option --requests: {}", num_requests);
+    spdlog::info("command line option --parallel: {}", num_parallel);
+    spdlog::info("command line option --metrics-port: {}", metrics_port);
 
-    if (show_help)
+    if (show_help || num_requests < 1 || num_parallel < 1)
         show_usage_and_exit(cli, argv[0], description, example);
 
-    return std::make_tuple(url, logfile_name, std::chrono::seconds{interval}, std::chrono::milliseconds{timeout});
+    return std::make_tuple(url, logfile_name, trace_filename, std::chrono::seconds{interval}, std::chrono::milliseconds{timeout}, metrics_port, run_throughput, num_requests, num_parallel);
 }
 
 int main(int argc, char* argv[])
 {
-    auto [url, logfile_name, interval, timeout] = eval_args(argc, argv);
+    auto [url, logfile_name, trace_filename, interval, timeout, metrics_port, run_throughput, num_requests, num_parallel] = eval_args(argc, argv);
 
     std::signal(SIGINT, signal_handler);
     create_combined_logger(logfile_name);
 
-    const auto [durations, num_errors] = continuously_send_pings(url, interval, timeout);
+    if (!trace_filename.empty())
+        start_trace(trace_filename);
+
+    if (run_throughput) {
+        measure_throughput_configs(url, timeout, num_requests, num_parallel);
+        finish_trace();
+        return 0;
+    }
+
+    // the metrics server threads are detached and can outlive main()
+    static Metrics metrics;
+
+    if (metrics_port > 0)
+        start_metrics_server(metrics_port, metrics, "http_ping");
+
+    const auto [durations, num_errors] = continuously_send_pings(url, interval, timeout, metrics);
 
     show_stats(url, durations, num_errors);
+
+    finish_trace();
 }
@@ -11,8 +11,10 @@
 #include <nlohmann/json.hpp>
 #include <spdlog/spdlog.h>
 
+#include "common/capture.h"
 #include "common/combined_logger.h"
 #include "common/msg.h"
+#include "common/trace.h"
 #include "common/usage.h"
 
 using namespace std::chrono_literals;
@@ -24,7 +26,7 @@ void msg_create_cos(cpr::Session& sess, const int count)
     const auto res = msg(sess, "performance.create_cos", {{"count", std::to_string(count)}});
 
     if (res.has_value() && res->status == 0)
-        spdlog::get("combined")->info("{}ms (count: {})", res->json["duration"], count);
+        spdlog::get("combined")->info("{:.3f}ms (count: {})", res->json["duration"].get<double>(), count);
 }
 
 auto eval_args(int argc, char* argv[])
@@ -39,6 +41,8 @@ auto eval_args(int argc, char* argv[])
     std::string user;
     std::string password;
     std::string logfile_name{"logs/msg_create_cos.log"};
+    std::string trace_filename;
+    std::string capture_filename;
 
     auto cli = (
         clipp::option("-h", "--help").set(show_help)
@@ -53,6 +57,10 @@ auto eval_args(int argc, char* argv[])
             % "Login password",
         (clipp::option("--log") & clipp::value("logfile", logfile_name))
             % fmt::format("logfile name (default: {})", logfile_name),
+        (clipp::option("--trace") & clipp::value("tracefile", trace_filename))
+            % "write a trace file in Chrome trace-event format (open it in Perfetto)",
+        (clipp::option("--capture") & clipp::value("capturefile", capture_filename))
+            % "record every message to a capture file for msg_replay",
         (clipp::option("--timeout") & clipp::integer("timeout", timeout))
             % fmt::format("request timeout in milliseconds (default: {}ms)", timeout),
         (clipp::option("--count") & clipp::integer("count", count))
@@ -67,22 +75,32 @@ auto eval_args(int argc, char* argv[])
     spdlog::info("command line option \"user\": {}", user);
     spdlog::info("command line option \"password\": ???");
     spdlog::info("command line option --log: {}", logfile_name);
+    spdlog::info("command line option --trace: {}", trace_filename);
+    spdlog::info("command line option --capture: {}", capture_filename);
     spdlog::info("command line option --timeout: {}ms", timeout);
     spdlog::info("command line option --count: {}", count);
 
     if (show_help)
         show_usage_and_exit(cli, argv[0], description, example);
 
-    return std::make_tuple(url, user, password, logfile_name, std::chrono::milliseconds{timeout}, count);
+    return std::make_tuple(url, user, password, logfile_name, trace_filename, capture_filename, std::chrono::milliseconds{timeout}, count);
 }
 
 int main(int argc, char* argv[])
 {
-    const auto [url, user, password, logfile_name, timeout, count] = eval_args(argc, argv);
+    const auto [url, user, password, logfile_name, trace_filename, capture_filename, timeout, count] = eval_args(argc, argv);
 
     create_combined_logger(logfile_name);
 
+    if (!trace_filename.empty())
+        start_trace(trace_filename);
+
+    if (!capture_filename.empty())
+        start_capture(capture_filename);
+
     auto sess = msg_login(url, user, password, timeout);
     msg_create_cos(sess, count);
     msg_logout(sess);
+
+    finish_trace();
 }
@@ -11,8 +11,10 @@
 #include <nlohmann/json.hpp>
 #include <spdlog/spdlog.h>
 
+#include "common/capture.h"
 #include "common/combined_logger.h"
 #include "common/msg.h"
+#include "common/trace.h"
 #include "common/usage.h"
 
 using namespace std::chrono_literals;
@@ -25,7 +27,7 @@ void test_single_inserts(cpr::Session& sess, const int num_insert_rows)
         {{"rows", std::to_string(num_insert_rows)}});
 
     if (res.has_value() && res->status == 0)
-        spdlog::get("combined")->info("test single: {} rows in {}ms", num_insert_rows, res->json["duration"]);
+        spdlog::get("combined")->info("test single: {} rows in {:.3f}ms", num_insert_rows, res->json["duration"].get<double>());
 }
 
 void test_multiple_inserts(cpr::Session& sess, const int num_insert_rows, const int num_rows_per_multi_insert)
@@ -36,7 +38,7 @@ void test_multiple_inserts(cpr::Session& sess, const int num_insert_rows, const
         {{"rows", std::to_string(num_insert_rows)}, {"rows_per_multi_insert", std::to_string(num_rows_per_multi_insert)}});
 
     if (res.has_value() && res->status == 0)
-        spdlog::get("combined")->info("test multi: {} rows in {}ms (rows per insert: {})", num_insert_rows, res->json["duration"], num_rows_per_multi_insert);
+        spdlog::get("combined")->info("test multi: {} rows in {:.3f}ms (rows per insert: {})", num_insert_rows, res->json["duration"].get<double>(), num_rows_per_multi_insert);
 }
 
 auto eval_args(int argc, char* argv[])
@@ -55,6 +57,8 @@ auto eval_args(int argc, char* argv[])
     std::string user;
     std::string password;
     std::string logfile_name{"logs/msg_db_insert.log"};
+    std::string trace_filename;
+    std::string capture_filename;
 
     auto cli = (
         clipp::option("-h", "--help").set(show_help)
@@ -75,6 +79,10 @@ auto eval_args(int argc, char* argv[])
             % "Login password",
         (clipp::option("--log") & clipp::value("logfile", logfile_name))
             % fmt::format("logfile name (default: {})", logfile_name),
+        (clipp::option("--trace") & clipp::value("tracefile", trace_filename))
+            % "write a trace file in Chrome trace-event format (open it in Perfetto)",
+        (clipp::option("--capture") & clipp::value("capturefile", capture_filename))
+            % "record every message to a capture file for msg_replay",
         (clipp::option("--timeout") & clipp::integer("timeout", timeout))
             % fmt::format("request timeout in milliseconds (default: {}ms)", timeout),
         (clipp::option("--rows") & clipp::value("num_insert_rows", num_insert_rows))
@@ -91,6 +99,8 @@ auto eval_args(int argc, char* argv[])
     spdlog::info("command line option \"user\": {}", user);
     spdlog::info("command line option \"password\": ???");
     spdlog::info("command line option --log: {}", logfile_name);
+    spdlog::info("command line option --trace: {}", trace_filename);
+    spdlog::info("command line option --capture: {}", capture_filename);
     spdlog::info("command line option --timeout: {}ms", timeout);
     spdlog::info("command line option --single: {}", run_single);
     spdlog::info("command line option --multi: {}", run_multi);
@@ -106,22 +116,30 @@ auto eval_args(int argc, char* argv[])
     if (show_help)
         show_usage_and_exit(cli, argv[0], description, example);
 
-    return std::make_tuple(url, user, password, logfile_name, std::chrono::milliseconds{timeout}, run_single, run_multi, num_insert_rows, num_rows_per_multi_insert);
+    return std::make_tuple(url, user, password, logfile_name, trace_filename, capture_filename, std::chrono::milliseconds{timeout}, run_single, run_multi, num_insert_rows, num_rows_per_multi_insert);
 }
 
 int main(int argc, char* argv[])
 {
-    const auto [url, user, password, logfile_name, timeout, run_single, run_multi, num_insert_rows, num_rows_per_multi_insert] = eval_args(argc, argv);
+    const auto [url, user, password, logfile_name, trace_filename, capture_filename, timeout, run_single, run_multi, num_insert_rows, num_rows_per_multi_insert] = eval_args(argc, argv);
 
     create_combined_logger(logfile_name);
 
+    if (!trace_filename.empty())
+        start_trace(trace_filename);
+
+    if (!capture_filename.empty())
+        start_capture(capture_filename);
+
     auto sess = msg_login(url, user, password, timeout);
 
     if (run_single)
         test_single_inserts(sess, num_insert_rows);
 
-    if (run_single)
+    if (run_multi)
         test_multiple_inserts(sess, num_insert_rows, num_rows_per_multi_insert);
 
     msg_logout(sess);
+
+    finish_trace();
 }
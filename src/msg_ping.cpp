@@ -1,5 +1,6 @@
 #include <chrono>
 #include <csignal>
+#include <optional>
 #include <string>
 #include <thread>
 #include <tuple>
@@ -12,9 +13,12 @@
 #include <nlohmann/json.hpp>
 #include <spdlog/spdlog.h>
 
+#include "common/capture.h"
 #include "common/combined_logger.h"
+#include "common/metrics.h"
 #include "common/msg.h"
 #include "common/statistics.h"
+#include "common/trace.h"
 #include "common/usage.h"
 
 using namespace std::chrono_literals;
@@ -29,7 +33,27 @@ void signal_handler(int signal)
     }
 }
 
-auto continuously_send_pings(cpr::Session& sess, std::chrono::seconds interval)
+// Send one ping or a batch of pings in one request.
+std::optional<MessageResults> send_ping(cpr::Session& sess, const int batch_size)
+{
+    if (batch_size == 1)
+        return msg(sess, "performance.ping", {});
+
+    auto res = msg_batch(sess, std::vector<Message>(static_cast<std::size_t>(batch_size), Message{"performance.ping", {}}));
+
+    if (res.has_value() && res->status == 0) {
+        for (const auto& result : res->json["results"]) {
+            if (result["status"] != 0) {
+                res->status = result["status"];
+                break;
+            }
+        }
+    }
+
+    return res;
+}
+
+auto continuously_send_pings(cpr::Session& sess, std::chrono::seconds interval, const int batch_size, Metrics& metrics)
 {
     spdlog::info("sending messages to {}...", sess.Get().url);
 
@@ -37,13 +61,20 @@ auto continuously_send_pings(cpr::Session& sess, std::chrono::seconds interval)
     std::vector<float> durations;
 
     while (running) {
-        const auto res = msg(sess, "performance.ping", {});
+        const auto res = send_ping(sess, batch_size);
 
         if (res.has_value() && res->status == 0) {
-            spdlog::get("combined")->info("{} --> {:.0f}ms", sess.Get().url, res->elapsed);
+            if (batch_size == 1)
+                spdlog::get("combined")->info("{} --> {:.3f}ms", sess.Get().url, res->elapsed);
+            else
+                spdlog::get("combined")->info("{} --> {:.3f}ms (batch: {}, {:.3f}ms per message, dispatch: {:.3f}ms)",
+                    sess.Get().url, res->elapsed, batch_size, res->elapsed / static_cast<float>(batch_size), res->json["duration"].get<double>());
+
             durations.push_back(res->elapsed);
+            record_success(metrics, res->elapsed);
         } else {
             ++num_errors;
+            record_error(metrics);
         }
 
         std::this_thread::sleep_for(interval);
@@ -60,10 +91,14 @@ auto eval_args(int argc, char* argv[])
     auto log_level = spdlog::level::warn;
     int interval = 1;
     int timeout = 30000;
+    int metrics_port = 0;
+    int batch_size = 1;
     std::string url;
     std::string user;
     std::string password;
     std::string logfile_name{"logs/msg_ping.log"};
+    std::string trace_filename;
+    std::string capture_filename;
 
     auto cli = (
         clipp::option("-h", "--help").set(show_help)
@@ -78,10 +113,18 @@ auto eval_args(int argc, char* argv[])
             % "Login password",
         (clipp::option("--log") & clipp::value("logfile", logfile_name))
             % fmt::format("logfile name (default: {})", logfile_name),
+        (clipp::option("--trace") & clipp::value("tracefile", trace_filename))
+            % "write a trace file in Chrome trace-event format (open it in Perfetto)",
+        (clipp::option("--capture") & clipp::value("capturefile", capture_filename))
+            % "record every message to a capture file for msg_replay",
         (clipp::option("--interval") & clipp::integer("interval", interval))
             % fmt::format("wait \"interval\" seconds between each request (default: {}s)", interval),
         (clipp::option("--timeout") & clipp::integer("timeout", timeout))
-            % fmt::format("request timeout in milliseconds (default: {}ms)", timeout)
+            % fmt::format("request timeout in milliseconds (default: {}ms)", timeout),
+        (clipp::option("--batch") & clipp::integer("K", batch_size))
+            % fmt::format("send K ping messages in one batched request (default: {})", batch_size),
+        (clipp::option("--metrics-port") & clipp::integer("port", metrics_port))
+            % "serve live metrics in Prometheus format on http://127.0.0.1:<port>/metrics (default: off)"
     );
 
     if (!clipp::parse(argc, argv, cli))
@@ -92,25 +135,43 @@ auto eval_args(int argc, char* argv[])
     spdlog::info("command line option \"user\": {}", user);
     spdlog::info("command line option \"password\": ???");
     spdlog::info("command line option --log: {}", logfile_name);
+    spdlog::info("command line option --trace: {}", trace_filename);
+    spdlog::info("command line option --capture: {}", capture_filename);
     spdlog::info("command line option --interval: {}s", interval);
     spdlog::info("command line option --timeout: {}ms", timeout);
+    spdlog::info("command line option --batch: {}", batch_size);
+    spdlog::info("command line option --metrics-port: {}", metrics_port);
 
-    if (show_help)
+    if (show_help || batch_size < 1)
         show_usage_and_exit(cli, argv[0], description, example);
 
-    return std::make_tuple(url, user, password, logfile_name, std::chrono::seconds{interval}, std::chrono::milliseconds{timeout});
+    return std::make_tuple(url, user, password, logfile_name, trace_filename, capture_filename, std::chrono::seconds{interval}, std::chrono::milliseconds{timeout}, batch_size, metrics_port);
 }
 
 int main(int argc, char* argv[])
 {
-    const auto [url, user, password, logfile_name, interval, timeout] = eval_args(argc, argv);
+    const auto [url, user, password, logfile_name, trace_filename, capture_filename, interval, timeout, batch_size, metrics_port] = eval_args(argc, argv);
 
     std::signal(SIGINT, signal_handler);
     create_combined_logger(logfile_name);
 
+    if (!trace_filename.empty())
+        start_trace(trace_filename);
+
+    if (!capture_filename.empty())
+        start_capture(capture_filename);
+
+    // the metrics server threads are detached and can outlive main()
+    static Metrics metrics;
+
+    if (metrics_port > 0)
+        start_metrics_server(metrics_port, metrics, "msg_ping");
+
     auto sess = msg_login(url, user, password, timeout);
-    const auto [durations, num_errors] = continuously_send_pings(sess, interval);
+    const auto [durations, num_errors] = continuously_send_pings(sess, interval, batch_size, metrics);
     msg_logout(sess);
 
     show_stats(url, durations, num_errors);
+
+    finish_trace();
 }
@@ -0,0 +1,200 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <map>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <clipp.h>
+#include <cpr/cpr.h>
+#include <fmt/core.h>
+#include <fmt/ostream.h>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+#include "common/capture.h"
+#include "common/combined_logger.h"
+#include "common/msg.h"
+#include "common/statistics.h"
+#include "common/timing.h"
+#include "common/trace.h"
+#include "common/usage.h"
+
+using namespace std::chrono_literals;
+
+std::atomic<bool> running = true;
+
+void signal_handler(int signal)
+{
+    if (signal == SIGINT) {
+        fmt::print("\n");
+        running = false;
+    }
+}
+
+struct ReplayResults {
+    std::map<std::string, std::vector<float>> durations;
+    std::map<std::string, int> num_errors;
+};
+
+// Replay every record of one session at its (sped up) original send time.
+ReplayResults replay_session(cpr::Session& sess, const std::vector<const CaptureRecord*>& records, const TimingClock::time_point start, const double speedup)
+{
+    ReplayResults results;
+
+    for (const auto* record : records) {
+        if (!running)
+            break;
+
+        std::this_thread::sleep_until(start + std::chrono::microseconds{static_cast<long long>(static_cast<double>(record->send_time_us) / speedup)});
+
+        std::vector<cpr::Pair> data;
+
+        for (const auto& [key, value] : record->data)
+            data.emplace_back(key, value);
+
+        const auto res = msg(sess, record->fqmn, data);
+
+        if (res.has_value() && res->status == 0)
+            results.durations[record->fqmn].push_back(res->elapsed);
+        else
+            ++results.num_errors[record->fqmn];
+    }
+
+    return results;
+}
+
+void replay(const std::string& url, const std::string& user, const std::string& password, std::chrono::milliseconds timeout,
+    const std::vector<CaptureRecord>& records, const double speedup, const int num_sessions)
+{
+    // distribute the records round-robin over the sessions
+    std::vector<std::vector<const CaptureRecord*>> session_records(static_cast<std::size_t>(num_sessions));
+
+    for (std::size_t i = 0; i < records.size(); ++i)
+        session_records[i % session_records.size()].push_back(&records[i]);
+
+    std::vector<cpr::Session> sessions;
+
+    for (int i = 0; i < num_sessions; ++i)
+        sessions.push_back(msg_login(url, user, password, timeout));
+
+    spdlog::info("replaying {} messages with {} sessions (speedup: {}x)...", records.size(), num_sessions, speedup);
+
+    std::vector<ReplayResults> session_results(static_cast<std::size_t>(num_sessions));
+    std::vector<std::thread> threads;
+    const auto start = TimingClock::now();
+
+    for (std::size_t i = 0; i < sessions.size(); ++i)
+        threads.emplace_back([&, i] { session_results[i] = replay_session(sessions[i], session_records[i], start, speedup); });
+
+    for (auto& thread : threads)
+        thread.join();
+
+    const auto t1 = TimingClock::now();
+
+    for (auto& sess : sessions)
+        msg_logout(sess);
+
+    ReplayResults results;
+
+    for (const auto& session_result : session_results) {
+        for (const auto& [fqmn, durations] : session_result.durations)
+            results.durations[fqmn].insert(results.durations[fqmn].end(), durations.begin(), durations.end());
+
+        for (const auto& [fqmn, num_errors] : session_result.num_errors)
+            results.num_errors[fqmn] += num_errors;
+    }
+
+    // also report message types without a single successful message
+    for (const auto& [fqmn, num_errors] : results.num_errors)
+        results.durations.try_emplace(fqmn);
+
+    for (const auto& [fqmn, durations] : results.durations) {
+        spdlog::get("combined")->info("{} --> successful: {}, errors: {}, mean: {:.3f}ms, median: {:.3f}ms, p95: {:.3f}ms, p99: {:.3f}ms, max: {:.3f}ms",
+            fqmn, durations.size(), results.num_errors[fqmn], mean(durations), median(durations),
+            percentile(durations, 95.0f), percentile(durations, 99.0f), percentile(durations, 100.0f));
+    }
+
+    spdlog::get("combined")->info("replay: {} messages in {:.3f}ms (sessions: {}, speedup: {}x)",
+        records.size(), elapsed_ms(start, t1), num_sessions, speedup);
+}
+
+auto eval_args(int argc, char* argv[])
+{
+    const auto description = "Replay captured messages.";
+    const auto example = "https://example.com user password msg_ping.capture --speedup 10 --sessions 4";
+    bool show_help = false;
+    auto log_level = spdlog::level::warn;
+    int timeout = 30000;
+    int num_sessions = 1;
+    double speedup = 1.0;
+    std::string url;
+    std::string user;
+    std::string password;
+    std::string capture_filename;
+    std::string logfile_name{"logs/msg_replay.log"};
+    std::string trace_filename;
+
+    auto cli = (
+        clipp::option("-h", "--help").set(show_help)
+            % "show help",
+        clipp::option("-v", "--verbose").set(log_level, spdlog::level::info)
+            % "show verbose output",
+        clipp::value("host", url)
+            % "Host URL",
+        clipp::value("user", user)
+            % "Login user name",
+        clipp::value("password", password)
+            % "Login password",
+        clipp::value("capturefile", capture_filename)
+            % "capture file recorded with --capture",
+        (clipp::option("--log") & clipp::value("logfile", logfile_name))
+            % fmt::format("logfile name (default: {})", logfile_name),
+        (clipp::option("--trace") & clipp::value("tracefile", trace_filename))
+            % "write a trace file in Chrome trace-event format (open it in Perfetto)",
+        (clipp::option("--timeout") & clipp::integer("timeout", timeout))
+            % fmt::format("request timeout in milliseconds (default: {}ms)", timeout),
+        (clipp::option("--speedup") & clipp::number("N", speedup))
+            % fmt::format("replay N times faster than recorded (default: {})", speedup),
+        (clipp::option("--sessions") & clipp::integer("M", num_sessions))
+            % fmt::format("number of concurrent sessions (default: {})", num_sessions)
+    );
+
+    if (!clipp::parse(argc, argv, cli))
+        show_usage_and_exit(cli, argv[0], description, example);
+
+    spdlog::set_level(log_level);
+    spdlog::info("command line option \"url\": {}", url);
+    spdlog::info("command line option \"user\": {}", user);
+    spdlog::info("command line option \"password\": ???");
+    spdlog::info("command line option \"capturefile\": {}", capture_filename);
+    spdlog::info("command line option --log: {}", logfile_name);
+    spdlog::info("command line option --trace: {}", trace_filename);
+    spdlog::info("command line option --timeout: {}ms", timeout);
+    spdlog::info("command line option --speedup: {}", speedup);
+    spdlog::info("command line option --sessions: {}", num_sessions);
+
+    if (show_help || speedup <= 0.0 || num_sessions < 1)
+        show_usage_and_exit(cli, argv[0], description, example);
+
+    return std::make_tuple(url, user, password, capture_filename, logfile_name, trace_filename, std::chrono::milliseconds{timeout}, speedup, num_sessions);
+}
+
+int main(int argc, char* argv[])
+{
+    const auto [url, user, password, capture_filename, logfile_name, trace_filename, timeout, speedup, num_sessions] = eval_args(argc, argv);
+
+    std::signal(SIGINT, signal_handler);
+    create_combined_logger(logfile_name);
+
+    if (!trace_filename.empty())
+        start_trace(trace_filename);
+
+    const auto records = read_capture(capture_filename);
+
+    replay(url, user, password, timeout, records, speedup, num_sessions);
+
+    finish_trace();
+}
@@ -0,0 +1,289 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <map>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <clipp.h>
+#include <fmt/core.h>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+#include "common/combined_logger.h"
+#include "common/http_server.h"
+#include "common/timing.h"
+#include "common/trace.h"
+#include "common/usage.h"
+
+using namespace std::chrono_literals;
+
+std::atomic<bool> running = true;
+std::atomic<long long> num_requests = 0;
+
+void signal_handler(int signal)
+{
+    if (signal == SIGINT) {
+        fmt::print("\n");
+        running = false;
+    }
+}
+
+// Simulated server-side processing time per message in milliseconds.
+struct LatencyDistribution {
+    enum class Type { fixed, uniform, normal, exponential };
+
+    Type type;
+    double a;
+    double b;
+};
+
+// Parse "fixed:<ms>", "uniform:<min>:<max>", "normal:<mean>:<stddev>" or "exp:<mean>".
+std::optional<LatencyDistribution> parse_latency_distribution(const std::string& s)
+{
+    std::vector<std::string> parts;
+    std::stringstream ss{s};
+
+    for (std::string part; std::getline(ss, part, ':');)
+        parts.push_back(part);
+
+    try {
+        if (parts.size() == 2 && parts[0] == "fixed")
+            return LatencyDistribution{LatencyDistribution::Type::fixed, std::stod(parts[1]), 0.0};
+        if (parts.size() == 3 && parts[0] == "uniform")
+            return LatencyDistribution{LatencyDistribution::Type::uniform, std::stod(parts[1]), std::stod(parts[2])};
+        if (parts.size() == 3 && parts[0] == "normal")
+            return LatencyDistribution{LatencyDistribution::Type::normal, std::stod(parts[1]), std::stod(parts[2])};
+        if (parts.size() == 2 && parts[0] == "exp")
+            return LatencyDistribution{LatencyDistribution::Type::exponential, std::stod(parts[1]), 0.0};
+    } catch (const std::exception&) {
+    }
+
+    return {};
+}
+
+std::chrono::microseconds sample_latency(const LatencyDistribution& latency)
+{
+    thread_local std::mt19937 rng{std::random_device{}()};
+    double ms = 0.0;
+
+    switch (latency.type) {
+        case LatencyDistribution::Type::fixed: ms = latency.a; break;
+        case LatencyDistribution::Type::uniform: ms = std::uniform_real_distribution<double>{latency.a, latency.b}(rng); break;
+        case LatencyDistribution::Type::normal: ms = std::normal_distribution<double>{latency.a, latency.b}(rng); break;
+        case LatencyDistribution::Type::exponential: ms = std::exponential_distribution<double>{1.0 / latency.a}(rng); break;
+    }
+
+    return std::chrono::microseconds{static_cast<long long>(std::max(0.0, ms) * 1000.0)};
+}
+
+std::string url_decode(const std::string_view& s)
+{
+    std::string decoded;
+    decoded.reserve(s.size());
+
+    for (std::size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '+') {
+            decoded += ' ';
+        } else if (s[i] == '%' && i + 2 < s.size()) {
+            decoded += static_cast<char>(std::stoi(std::string{s.substr(i + 1, 2)}, nullptr, 16));
+            i += 2;
+        } else {
+            decoded += s[i];
+        }
+    }
+
+    return decoded;
+}
+
+// Parse an application/x-www-form-urlencoded body.
+std::map<std::string, std::string> parse_form(const std::string_view& body)
+{
+    std::map<std::string, std::string> form;
+    std::size_t pos = 0;
+
+    while (pos < body.size()) {
+        const auto end = std::min(body.find('&', pos), body.size());
+        const auto pair = body.substr(pos, end - pos);
+        const auto eq = pair.find('=');
+
+        if (eq != std::string_view::npos)
+            form[url_decode(pair.substr(0, eq))] = url_decode(pair.substr(eq + 1));
+        else
+            form[url_decode(pair)] = "";
+
+        pos = end + 1;
+    }
+
+    return form;
+}
+
+// Milliseconds since start, rounded to microseconds like performance_elapsed_ms() in performance.php.
+double elapsed_ms_rounded(const TimingClock::time_point start)
+{
+    return std::round(elapsed_ms(start, TimingClock::now()) * 1000.0) / 1000.0;
+}
+
+// Handle one message like cmd.php does and fill its "out" values. Returns the message status.
+int handle_message(const std::string& fqmn, const nlohmann::json& in, nlohmann::json& out, const LatencyDistribution& latency)
+{
+    if (fqmn == "login.login" || fqmn == "login.logout" || fqmn == "performance.ping")
+        return 0;
+
+    if (fqmn == "performance.db_insert_single" || fqmn == "performance.db_insert_multi" || fqmn == "performance.create_cos") {
+        const auto t0 = TimingClock::now();
+        std::this_thread::sleep_for(sample_latency(latency));
+        out["duration"] = elapsed_ms_rounded(t0);
+        return 0;
+    }
+
+    if (fqmn == "performance.batch") {
+        const auto messages = nlohmann::json::parse(in.value("messages", "[]"), nullptr, false);
+
+        if (!messages.is_array())
+            return -1;
+
+        const auto t0 = TimingClock::now();
+        auto results = nlohmann::json::array();
+
+        for (const auto& message : messages) {
+            nlohmann::json msg_out = nlohmann::json::object();
+            const auto fqmn_in_batch = message.value("msg", "");
+            const int status = fqmn_in_batch == "performance.ping" ? handle_message(fqmn_in_batch, message.value("in", nlohmann::json::object()), msg_out, latency) : -2;
+            results.push_back({{"msg", fqmn_in_batch}, {"status", status}, {"out", msg_out}});
+        }
+
+        out["results"] = results;
+        out["duration"] = elapsed_ms_rounded(t0);
+        return 0;
+    }
+
+    return -1;
+}
+
+HttpResponse handle_request(const HttpRequest& request, const LatencyDistribution& latency, const std::string& padding)
+{
+    if (request.target != "/cmd.php")
+        return HttpResponse{404, "text/plain", "not found\n"};
+
+    if (request.method != "POST")
+        return HttpResponse{405, "text/plain", "method not allowed\n"};
+
+    ++num_requests;
+
+    // simulated per-request overhead (session lookup, bootstrap, dispatch)
+    std::this_thread::sleep_for(sample_latency(latency));
+
+    const auto t0 = TimingClock::now();
+    const auto form = parse_form(request.body);
+    const auto it = form.find("msg");
+    const std::string fqmn = it != form.end() ? it->second : "";
+
+    nlohmann::json in = nlohmann::json::object();
+
+    for (const auto& [key, value] : form)
+        in[key] = value;
+
+    trace_event(fqmn, "parse", t0, TimingClock::now());
+
+    nlohmann::json json = nlohmann::json::object();
+    const int status = [&] {
+        TraceSpan span{fqmn, "generate"};
+        return handle_message(fqmn, in, json, latency);
+    }();
+
+    json["status"] = status;
+    json["status_msg"] = status == 0 ? "OK" : fmt::format("unknown or invalid message: {}", fqmn);
+
+    if (!padding.empty())
+        json["padding"] = padding;
+
+    spdlog::info("{} --> {}", fqmn, status);
+
+    TraceSpan span{fqmn, "serialize"};
+    return HttpResponse{200, "application/json", json.dump()};
+}
+
+auto eval_args(int argc, char* argv[])
+{
+    const auto description = "Local cmd.php stub server for client-side message benchmarks.";
+    const auto example = "--port 8080 --latency normal:5:1 --response-size 1024";
+    bool show_help = false;
+    auto log_level = spdlog::level::warn;
+    int port = 8080;
+    int response_size = 0;
+    std::string address{"127.0.0.1"};
+    std::string latency{"fixed:0"};
+    std::string logfile_name{"logs/msg_stub_server.log"};
+    std::string trace_filename;
+
+    auto cli = (
+        clipp::option("-h", "--help").set(show_help)
+            % "show help",
+        clipp::option("-v", "--verbose").set(log_level, spdlog::level::info)
+            % "show verbose output",
+        (clipp::option("--log") & clipp::value("logfile", logfile_name))
+            % fmt::format("logfile name (default: {})", logfile_name),
+        (clipp::option("--trace") & clipp::value("tracefile", trace_filename))
+            % "write a trace file in Chrome trace-event format (open it in Perfetto)",
+        (clipp::option("--address") & clipp::value("address", address))
+            % fmt::format("listen address (default: {})", address),
+        (clipp::option("--port") & clipp::integer("port", port))
+            % fmt::format("listen port (default: {})", port),
+        (clipp::option("--latency") & clipp::value("distribution", latency))
+            % fmt::format("simulated latency in ms per request and per test message: fixed:<ms>, uniform:<min>:<max>, normal:<mean>:<stddev> or exp:<mean> (default: {})", latency),
+        (clipp::option("--response-size") & clipp::integer("bytes", response_size))
+            % fmt::format("additional padding bytes in every response (default: {})", response_size)
+    );
+
+    if (!clipp::parse(argc, argv, cli))
+        show_usage_and_exit(cli, argv[0], description, example);
+
+    spdlog::set_level(log_level);
+    spdlog::info("command line option --log: {}", logfile_name);
+    spdlog::info("command line option --trace: {}", trace_filename);
+    spdlog::info("command line option --address: {}", address);
+    spdlog::info("command line option --port: {}", port);
+    spdlog::info("command line option --latency: {}", latency);
+    spdlog::info("command line option --response-size: {}", response_size);
+
+    const auto latency_distribution = parse_latency_distribution(latency);
+
+    if (show_help || !latency_distribution.has_value() || response_size < 0)
+        show_usage_and_exit(cli, argv[0], description, example);
+
+    return std::make_tuple(logfile_name, trace_filename, address, port, *latency_distribution, response_size);
+}
+
+int main(int argc, char* argv[])
+{
+    const auto [logfile_name, trace_filename, address, port, latency, response_size] = eval_args(argc, argv);
+
+    std::signal(SIGINT, signal_handler);
+    create_combined_logger(logfile_name);
+
+    if (!trace_filename.empty())
+        start_trace(trace_filename);
+
+    const std::string padding(static_cast<std::size_t>(response_size), 'x');
+
+    start_http_server(address, port, [latency = latency, &padding](const HttpRequest& request) {
+        return handle_request(request, latency, padding);
+    });
+
+    spdlog::get("combined")->info("stub server listening on http://{}:{}/cmd.php", address, port);
+
+    while (running)
+        std::this_thread::sleep_for(100ms);
+
+    spdlog::get("combined")->info("stub server: {} requests", num_requests.load());
+
+    finish_trace();
+}